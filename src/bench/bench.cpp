@@ -0,0 +1,769 @@
+// Micro-benchmarks of the wrapper functions against the corresponding calls of the sqlite3 C API, on an in-memory
+// database. The "preset" benchmarks compare the `open_options` presets with the SQLite defaults on a temporary file.
+//
+// Each benchmark prints the time (ns/op) and the number of C++ heap allocations (operator new, allocs/op) per
+// operation. The "C" lines are the baselines for the "C++" lines following them.
+//
+// Usage:
+//
+//     sqlitecpp-thin-bench-<style> [--iterations N] [filter]
+//
+// Without `--iterations` each benchmark runs for about 0.2 seconds. If `filter` is given, only the benchmarks whose
+// names contain it are run.
+
+#if SQLITECPPTHIN_BENCH_EXPECTED
+  #include "sqlitecpp-thin/sqlite3-expected.hpp"
+#else
+  #include "sqlitecpp-thin/sqlite3-exception.hpp"
+#endif
+
+#include "sqlitecpp-thin/allocator.hpp"
+#include "sqlitecpp-thin/checkpointer.hpp"
+#include "sqlitecpp-thin/interrupt.hpp"
+#include "sqlitecpp-thin/transaction.hpp"
+#include "sqlitecpp-thin/vtab.hpp"
+#include "sqlitecpp-thin/write_queue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+// Atomic since the writer thread of `write_queue` allocates too.
+std::atomic<size_t> g_num_allocations = 0;
+const void* volatile g_sink = nullptr;
+
+// Prevent the compiler from optimizing away the computation of `x`.
+template<class T>
+void do_not_optimize(const T& x)
+{
+    g_sink = &x;
+}
+
+[[noreturn]] void fail(const std::string& message)
+{
+    std::fprintf(stderr, "%s\n", message.c_str());
+    std::exit(EXIT_FAILURE);
+}
+
+#if SQLITECPPTHIN_BENCH_EXPECTED
+template<class T, class E>
+T checked(std::expected<T, E>&& x)
+{
+    if (!x) {
+        fail("Unexpected error: " + x.error().format());
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*x);
+    }
+}
+  #define CHECKED(X) checked(X)
+#else
+  #define CHECKED(X) X
+#endif
+
+// Path of a database file in the temporary directory, distinct for each library style: the benchmarks of the styles
+// run in parallel as tests.
+std::filesystem::path temp_database_path(const char* name)
+{
+    return std::filesystem::temp_directory_path()
+         / (std::string("sqlitecpp-thin-bench-") + (SQLITECPPTHIN_BENCH_EXPECTED ? "expected-" : "exception-") + name
+            + ".db");
+}
+
+// Remove the database file and its journal, WAL and shared-memory files.
+void remove_database(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    for (auto* suffix : {"", "-journal", "-wal", "-shm"}) {
+        std::filesystem::remove(path.string() + suffix, ec);
+    }
+}
+
+void check_rc(int rc, int expected_rc = SQLITE_OK)
+{
+    if (rc != expected_rc) {
+        fail("Unexpected result code: " + std::to_string(rc));
+    }
+}
+
+class runner
+{
+public:
+    runner(size_t iterations, std::string_view filter)
+        : _iterations(iterations)
+        , _filter(filter)
+    {
+    }
+
+    template<class F>
+    void run(std::string_view name, F&& f)
+    {
+        using clock = std::chrono::steady_clock;
+        if (name.find(_filter) == std::string_view::npos) {
+            return;
+        }
+
+        // Warm-up.
+        for (size_t i = 0; i < std::min<size_t>(_iterations ? _iterations : 1000, 1000); ++i) {
+            f();
+        }
+
+        size_t num_ops = 0;
+        const auto allocations_before = g_num_allocations.load(std::memory_order_relaxed);
+        const auto t0 = clock::now();
+        auto t1 = t0;
+        if (_iterations) {
+            for (; num_ops < _iterations; ++num_ops) {
+                f();
+            }
+            t1 = clock::now();
+        } else {
+            constexpr auto k_min_duration = std::chrono::milliseconds(200);
+            constexpr size_t k_batch_size = 1000;
+            while (t1 - t0 < k_min_duration) {
+                for (size_t i = 0; i < k_batch_size; ++i) {
+                    f();
+                }
+                num_ops += k_batch_size;
+                t1 = clock::now();
+            }
+        }
+        const auto num_allocations = g_num_allocations.load(std::memory_order_relaxed) - allocations_before;
+
+        const auto ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        std::printf(
+          "%-48.*s %12.1f ns/op %8.2f allocs/op\n",
+          int(name.size()),
+          name.data(),
+          ns / double(num_ops),
+          double(num_allocations) / double(num_ops)
+        );
+    }
+
+private:
+    size_t _iterations;
+    std::string_view _filter;
+};
+
+constexpr int k_num_rows = 1000;
+
+sqlite::database open_test_database()
+{
+    auto db = CHECKED(sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE));
+    CHECKED(db.exec("CREATE TABLE t (a INTEGER, b REAL, s TEXT)"));
+    CHECKED(db.exec("BEGIN"));
+    auto stmt = CHECKED(db.prepare("INSERT INTO t(a, b, s) VALUES(?, ?, ?)"));
+    for (int i = 0; i < k_num_rows; ++i) {
+        CHECKED(stmt.execute(i, i * 0.5, "some text"));
+    }
+    CHECKED(db.exec("COMMIT"));
+    return db;
+}
+
+void bench_prepare(runner& r, sqlite::database& db)
+{
+    const char* sql = "SELECT a, b, s FROM t WHERE a = ?";
+    r.run("C   sqlite3_prepare_v2 + sqlite3_finalize", [&] {
+        sqlite3_stmt* stmt{};
+        check_rc(sqlite3_prepare_v2(db.handle(), sql, -1, &stmt, nullptr));
+        sqlite3_finalize(stmt);
+    });
+    r.run("C++ prepare", [&] {
+        auto stmt = CHECKED(db.prepare(sql));
+        do_not_optimize(stmt);
+    });
+    r.run("C++ prepare_cached", [&] {
+        auto stmt = CHECKED(db.prepare_cached(sql));
+        do_not_optimize(stmt);
+    });
+}
+
+void bench_bind(runner& r, sqlite::database& db)
+{
+    auto stmt = CHECKED(db.prepare("SELECT ?, ?, ?"));
+    auto* h = stmt.handle();
+    int i = 0;
+    const std::string_view text = "some text";
+
+    r.run("C   sqlite3_bind_int", [&] {
+        check_rc(sqlite3_bind_int(h, 1, ++i));
+    });
+    r.run("C++ bind_int", [&] {
+        CHECKED(stmt.bind_int(1, ++i));
+    });
+    r.run("C   sqlite3_bind_int64", [&] {
+        check_rc(sqlite3_bind_int64(h, 1, int64_t(++i)));
+    });
+    r.run("C++ bind_int(int64_t)", [&] {
+        CHECKED(stmt.bind_int(1, int64_t(++i)));
+    });
+    r.run("C   sqlite3_bind_double", [&] {
+        check_rc(sqlite3_bind_double(h, 1, double(++i)));
+    });
+    r.run("C++ bind_double", [&] {
+        CHECKED(stmt.bind_double(1, double(++i)));
+    });
+    r.run("C   sqlite3_bind_text64", [&] {
+        check_rc(sqlite3_bind_text64(h, 1, text.data(), text.size(), SQLITE_STATIC, SQLITE_UTF8));
+    });
+    r.run("C++ bind_text(string_view)", [&] {
+        CHECKED(stmt.bind_text(1, text));
+    });
+    r.run("C   sqlite3_bind_int + _double + _text64", [&] {
+        check_rc(sqlite3_bind_int(h, 1, ++i));
+        check_rc(sqlite3_bind_double(h, 2, 0.5));
+        check_rc(sqlite3_bind_text64(h, 3, text.data(), text.size(), SQLITE_STATIC, SQLITE_UTF8));
+    });
+    r.run("C++ bind_int + bind_double + bind_text", [&] {
+        CHECKED(stmt.bind_int(1, ++i));
+        CHECKED(stmt.bind_double(2, 0.5));
+        CHECKED(stmt.bind_text(3, text));
+    });
+    r.run("C++ bind_all(int, double, string_view)", [&] {
+        CHECKED(stmt.bind_all(++i, 0.5, text));
+    });
+}
+
+void bench_step(runner& r, sqlite::database& db)
+{
+    auto stmt = CHECKED(db.prepare("SELECT 1"));
+    auto* h = stmt.handle();
+    r.run("C   sqlite3_step + sqlite3_reset", [&] {
+        check_rc(sqlite3_step(h), SQLITE_ROW);
+        check_rc(sqlite3_reset(h));
+    });
+    r.run("C++ step + reset", [&] {
+        auto sr = CHECKED(stmt.step());
+        do_not_optimize(sr);
+        CHECKED(stmt.reset());
+    });
+}
+
+void bench_column(runner& r, sqlite::database& db)
+{
+    auto stmt = CHECKED(db.prepare("SELECT 42, 0.5, 'some text', NULL, 0"));
+    auto* h = stmt.handle();
+    check_rc(sqlite3_step(h), SQLITE_ROW);
+
+    r.run("C   sqlite3_column_int", [&] {
+        do_not_optimize(sqlite3_column_int(h, 0));
+    });
+    r.run("C++ column_int", [&] {
+        do_not_optimize(CHECKED(stmt.column_int(0)));
+    });
+    r.run("C   sqlite3_column_int (zero)", [&] {
+        do_not_optimize(sqlite3_column_int(h, 4));
+    });
+    r.run("C++ column_int (zero)", [&] {
+        do_not_optimize(CHECKED(stmt.column_int(4)));
+    });
+    r.run("C   sqlite3_column_int64", [&] {
+        do_not_optimize(sqlite3_column_int64(h, 0));
+    });
+    r.run("C++ column_int64", [&] {
+        do_not_optimize(CHECKED(stmt.column_int64(0)));
+    });
+    r.run("C   sqlite3_column_text + sqlite3_column_bytes", [&] {
+        do_not_optimize(sqlite3_column_text(h, 2));
+        do_not_optimize(sqlite3_column_bytes(h, 2));
+    });
+    r.run("C++ column_text", [&] {
+        do_not_optimize(CHECKED(stmt.column_text(2)));
+    });
+    r.run("C   sqlite3_column_type + sqlite3_column_int (NULL)", [&] {
+        if (sqlite3_column_type(h, 3) != SQLITE_NULL) {
+            do_not_optimize(sqlite3_column_int(h, 3));
+        }
+    });
+    r.run("C++ column_int_opt (NULL)", [&] {
+        do_not_optimize(CHECKED(stmt.column_int_opt(3)));
+    });
+    auto u = stmt.unchecked();
+    r.run("C++ unchecked column_int (zero)", [&] {
+        do_not_optimize(u.column_int(4));
+    });
+    r.run("C++ unchecked column_int_opt (NULL)", [&] {
+        do_not_optimize(u.column_int_opt(3));
+    });
+}
+
+void bench_scan(runner& r, sqlite::database& db)
+{
+    auto stmt = CHECKED(db.prepare("SELECT a, b, s FROM t"));
+    auto* h = stmt.handle();
+
+    r.run("C   scan 1000 rows", [&] {
+        int rc;
+        while ((rc = sqlite3_step(h)) == SQLITE_ROW) {
+            do_not_optimize(sqlite3_column_int64(h, 0));
+            do_not_optimize(sqlite3_column_double(h, 1));
+            do_not_optimize(sqlite3_column_text(h, 2));
+            do_not_optimize(sqlite3_column_bytes(h, 2));
+        }
+        check_rc(rc, SQLITE_DONE);
+        check_rc(sqlite3_reset(h));
+    });
+    r.run("C++ scan 1000 rows: step + column_*", [&] {
+        while (CHECKED(stmt.step()) == sqlite::step_result::row) {
+            do_not_optimize(CHECKED(stmt.column_int64(0)));
+            do_not_optimize(CHECKED(stmt.column_double(h, 1)));
+            do_not_optimize(CHECKED(stmt.column_text(2)));
+        }
+        CHECKED(stmt.reset());
+    });
+    r.run("C++ scan 1000 rows: step + unchecked column_*", [&] {
+        auto u = stmt.unchecked();
+        while (CHECKED(stmt.step()) == sqlite::step_result::row) {
+            do_not_optimize(u.column_int64(0));
+            do_not_optimize(u.column_double(1));
+            do_not_optimize(u.column_text(2));
+            CHECKED(u.check());
+        }
+        CHECKED(stmt.reset());
+    });
+    r.run("C++ scan 1000 rows: rows<int64_t, double, string_view>", [&] {
+        auto rows = stmt.rows<int64_t, double, std::string_view>();
+        for (auto& row : rows) {
+            do_not_optimize(row);
+        }
+#if SQLITECPPTHIN_BENCH_EXPECTED
+        if (rows.get_error()) {
+            fail(rows.get_error()->format());
+        }
+#endif
+        CHECKED(stmt.reset());
+    });
+
+    auto numeric_stmt = CHECKED(db.prepare("SELECT a, b FROM t"));
+    std::vector<int64_t> a;
+    std::vector<double> b;
+    a.reserve(k_num_rows);
+    b.reserve(k_num_rows);
+    r.run("C++ scan 1000 rows: fetch_columns<int64_t, double>", [&] {
+        a.clear();
+        b.clear();
+        auto n = CHECKED(numeric_stmt.fetch_columns(k_num_rows + 1, a, b));
+        do_not_optimize(n);
+        CHECKED(numeric_stmt.reset());
+    });
+
+    // Cost of the deadline checks, compare with "step + unchecked column_*".
+    for (int progress_steps : {100, 1000}) {
+        const auto name = "C++ scan 1000 rows: interrupt_scope, " + std::to_string(progress_steps) + " steps";
+        r.run(name, [&] {
+            sqlite::interrupt_scope scope(
+              db,
+              sqlite::interrupt_options{
+                .deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10),
+                .progress_steps = progress_steps,
+              }
+            );
+            auto u = stmt.unchecked();
+            while (CHECKED(stmt.step()) == sqlite::step_result::row) {
+                do_not_optimize(u.column_int64(0));
+                do_not_optimize(u.column_double(1));
+                do_not_optimize(u.column_text(2));
+                CHECKED(u.check());
+            }
+            CHECKED(stmt.reset());
+        });
+    }
+}
+
+void bench_insert(runner& r, sqlite::database& db)
+{
+    CHECKED(db.exec("CREATE TABLE u (a INTEGER, b REAL, s TEXT)"));
+    auto stmt = CHECKED(db.prepare("INSERT INTO u(a, b, s) VALUES(?, ?, ?)"));
+    auto* h = stmt.handle();
+    auto del = CHECKED(db.prepare("DELETE FROM u"));
+    const std::string_view text = "some text";
+    int i = 0;
+
+    CHECKED(db.exec("BEGIN"));
+    r.run("C   insert: bind + step + reset", [&] {
+        check_rc(sqlite3_bind_int(h, 1, ++i));
+        check_rc(sqlite3_bind_double(h, 2, 0.5));
+        check_rc(sqlite3_bind_text64(h, 3, text.data(), text.size(), SQLITE_STATIC, SQLITE_UTF8));
+        check_rc(sqlite3_step(h), SQLITE_DONE);
+        check_rc(sqlite3_reset(h));
+    });
+    CHECKED(del.step_done_changes());
+    CHECKED(del.reset());
+    r.run("C++ insert: execute", [&] {
+        do_not_optimize(CHECKED(stmt.execute(++i, 0.5, text)));
+    });
+    CHECKED(db.exec("COMMIT"));
+}
+
+struct sum_of_squares {
+    double sum = 0;
+
+    void step(double x)
+    {
+        sum += x * x;
+    }
+    double final()
+    {
+        return sum;
+    }
+};
+
+void bench_functions(runner& r, sqlite::database& db)
+{
+    check_rc(sqlite3_create_function_v2(
+      db.handle(),
+      "c_square",
+      1,
+      SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+      nullptr,
+      [](sqlite3_context* ctx, int, sqlite3_value** argv) {
+          const double x = sqlite3_value_double(argv[0]);
+          sqlite3_result_double(ctx, x * x);
+      },
+      nullptr,
+      nullptr,
+      nullptr
+    ));
+    check_rc(sqlite3_create_function_v2(
+      db.handle(),
+      "c_sum_of_squares",
+      1,
+      SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+      nullptr,
+      nullptr,
+      [](sqlite3_context* ctx, int, sqlite3_value** argv) {
+          if (auto* sum = static_cast<double*>(sqlite3_aggregate_context(ctx, sizeof(double)))) {
+              const double x = sqlite3_value_double(argv[0]);
+              *sum += x * x;
+          } else {
+              sqlite3_result_error_nomem(ctx);
+          }
+      },
+      [](sqlite3_context* ctx) {
+          auto* sum = static_cast<double*>(sqlite3_aggregate_context(ctx, 0));
+          sqlite3_result_double(ctx, sum ? *sum : 0.0);
+      },
+      nullptr
+    ));
+    CHECKED(db.create_function("cpp_square", [](double x) { return x * x; }, SQLITE_DETERMINISTIC));
+    CHECKED(db.create_aggregate<sum_of_squares>("cpp_sum_of_squares", SQLITE_DETERMINISTIC));
+
+    auto c_scalar = CHECKED(db.prepare("SELECT sum(c_square(b)) FROM t"));
+    auto cpp_scalar = CHECKED(db.prepare("SELECT sum(cpp_square(b)) FROM t"));
+    r.run("C   function: 1000 calls", [&] {
+        check_rc(sqlite3_step(c_scalar.handle()), SQLITE_ROW);
+        check_rc(sqlite3_reset(c_scalar.handle()));
+    });
+    r.run("C++ function: 1000 calls, create_function", [&] {
+        check_rc(sqlite3_step(cpp_scalar.handle()), SQLITE_ROW);
+        check_rc(sqlite3_reset(cpp_scalar.handle()));
+    });
+
+    auto c_aggregate = CHECKED(db.prepare("SELECT c_sum_of_squares(b) FROM t GROUP BY a % 250"));
+    auto cpp_aggregate = CHECKED(db.prepare("SELECT cpp_sum_of_squares(b) FROM t GROUP BY a % 250"));
+    auto run_grouped = [](sqlite3_stmt* h) {
+        int rc;
+        while ((rc = sqlite3_step(h)) == SQLITE_ROW) {
+        }
+        check_rc(rc, SQLITE_DONE);
+        check_rc(sqlite3_reset(h));
+    };
+    r.run("C   aggregate: 250 groups", [&] {
+        run_grouped(c_aggregate.handle());
+    });
+    r.run("C++ aggregate: 250 groups, create_aggregate", [&] {
+        run_grouped(cpp_aggregate.handle());
+    });
+}
+
+struct bench_row {
+    int64_t id;
+    double b;
+};
+
+void bench_span_table(runner& r, sqlite::database& db)
+{
+    std::vector<bench_row> rows;
+    for (int i = 0; i < k_num_rows; ++i) {
+        rows.push_back(bench_row{.id = i, .b = i * 0.5});
+    }
+    CHECKED(sqlite::register_span_table(
+      db,
+      "span_t",
+      sqlite::span_table<bench_row>{
+        .rows = rows,
+        .columns =
+          {
+            sqlite::table_column<bench_row, &bench_row::id>("id INTEGER"),
+            sqlite::table_column<bench_row, &bench_row::b>("b REAL"),
+          },
+        .sorted_key = 0,
+      }
+    ));
+    CHECKED(db.exec("CREATE TABLE pk_t (id INTEGER PRIMARY KEY, b REAL)"));
+    CHECKED(db.exec("INSERT INTO pk_t SELECT id, b FROM span_t"));
+
+    auto c_lookup = CHECKED(db.prepare("SELECT b FROM pk_t WHERE id = ?"));
+    auto cpp_lookup = CHECKED(db.prepare("SELECT b FROM span_t WHERE id = ?"));
+    int i = 0;
+    r.run("C   lookup by INTEGER PRIMARY KEY", [&] {
+        check_rc(sqlite3_bind_int(c_lookup.handle(), 1, ++i % k_num_rows));
+        check_rc(sqlite3_step(c_lookup.handle()), SQLITE_ROW);
+        check_rc(sqlite3_reset(c_lookup.handle()));
+    });
+    r.run("C++ lookup by sorted key: span_table", [&] {
+        check_rc(sqlite3_bind_int(cpp_lookup.handle(), 1, ++i % k_num_rows));
+        check_rc(sqlite3_step(cpp_lookup.handle()), SQLITE_ROW);
+        check_rc(sqlite3_reset(cpp_lookup.handle()));
+    });
+}
+
+void bench_bind_array(runner& r, sqlite::database& db)
+{
+    CHECKED(sqlite::register_carray(db));
+    const std::vector<int64_t> ids = {3, 14, 15, 92, 65, 358, 979, 323, 846, 264};
+    auto in_list = CHECKED(db.prepare("SELECT sum(b) FROM t WHERE rowid IN (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"));
+    auto in_carray = CHECKED(db.prepare("SELECT sum(b) FROM t WHERE rowid IN carray(?)"));
+    r.run("C   IN (?, ..., ?): bind 10 ids + step", [&] {
+        auto* h = in_list.handle();
+        for (int i = 0; i < 10; ++i) {
+            check_rc(sqlite3_bind_int64(h, i + 1, ids[size_t(i)]));
+        }
+        check_rc(sqlite3_step(h), SQLITE_ROW);
+        check_rc(sqlite3_reset(h));
+    });
+    r.run("C++ IN carray(?): bind_array 10 ids + step", [&] {
+        CHECKED(in_carray.bind_array(1, ids));
+        check_rc(sqlite3_step(in_carray.handle()), SQLITE_ROW);
+        check_rc(sqlite3_reset(in_carray.handle()));
+    });
+}
+
+void bench_transaction(runner& r, sqlite::database& db)
+{
+    r.run("C++ exec BEGIN + exec COMMIT", [&] {
+        CHECKED(db.exec("BEGIN"));
+        CHECKED(db.exec("COMMIT"));
+    });
+    r.run("C++ begin_transaction + commit", [&] {
+        auto tx = CHECKED(sqlite::begin_transaction(db));
+        CHECKED(tx.commit());
+    });
+    r.run("C++ nested begin_transaction + commit", [&] {
+        auto outer = CHECKED(sqlite::begin_transaction(db));
+        auto inner = CHECKED(sqlite::begin_transaction(db));
+        CHECKED(inner.commit());
+        CHECKED(outer.commit());
+    });
+}
+
+void bench_write_queue(runner& r)
+{
+    const auto path = temp_database_path("write-queue");
+
+    // Compare with "preset oltp_wal: autocommit insert".
+    remove_database(path);
+    {
+        auto db = CHECKED(sqlite::open(path, sqlite::open_options::oltp_wal()));
+        CHECKED(db.exec("CREATE TABLE u (a INTEGER, s TEXT)"));
+    }
+    {
+        sqlite::write_queue q(CHECKED(sqlite::open(path, sqlite::open_options::oltp_wal())));
+        int i = 0;
+        r.run("write_queue: insert, wait", [&] {
+            CHECKED(q.submit_execute("INSERT INTO u(a, s) VALUES(?, 'some text')", ++i).get());
+        });
+        // Waiting every 100 jobs lets the writer group them.
+        std::vector<std::future<sqlite::expected<int, sqlite::error>>> futures;
+        r.run("write_queue: insert, wait every 100", [&] {
+            futures.push_back(q.submit_execute("INSERT INTO u(a, s) VALUES(?, 'some text')", ++i));
+            if (futures.size() == 100) {
+                for (auto& f : futures) {
+                    CHECKED(f.get());
+                }
+                futures.clear();
+            }
+        });
+        for (auto& f : futures) {
+            CHECKED(f.get());
+        }
+    }
+    remove_database(path);
+}
+
+void bench_checkpointer(runner& r)
+{
+    const auto path = temp_database_path("checkpointer");
+
+    // Compare with "preset oltp_wal: autocommit insert", which checkpoints on the committing thread.
+    remove_database(path);
+    {
+        auto db = CHECKED(sqlite::open(path, sqlite::open_options::oltp_wal()));
+        CHECKED(db.exec("CREATE TABLE u (a INTEGER, s TEXT)"));
+        sqlite::checkpointer c(CHECKED(sqlite::open(path, sqlite::open_options::oltp_wal())));
+        c.attach(db);
+        auto stmt = CHECKED(db.prepare("INSERT INTO u(a, s) VALUES(?, ?)"));
+        int i = 0;
+        r.run("checkpointer: autocommit insert", [&] {
+            do_not_optimize(CHECKED(stmt.execute(++i, "some text")));
+        });
+        c.detach(db);
+    }
+    remove_database(path);
+}
+
+void bench_open_presets(runner& r)
+{
+    const auto path = temp_database_path("presets");
+
+    const std::pair<const char*, sqlite::open_options> write_presets[] = {
+      {"preset default: autocommit insert", sqlite::open_options{}},
+      {"preset bulk_load: autocommit insert", sqlite::open_options::bulk_load()},
+      {"preset oltp_wal: autocommit insert", sqlite::open_options::oltp_wal()},
+    };
+    for (auto& [name, options] : write_presets) {
+        remove_database(path);
+        {
+            auto db = CHECKED(sqlite::open(path, options));
+            CHECKED(db.exec("CREATE TABLE u (a INTEGER, s TEXT)"));
+            auto stmt = CHECKED(db.prepare("INSERT INTO u(a, s) VALUES(?, ?)"));
+            int i = 0;
+            r.run(name, [&] {
+                do_not_optimize(CHECKED(stmt.execute(++i, "some text")));
+            });
+        }
+    }
+
+    remove_database(path);
+    {
+        auto db = CHECKED(sqlite::open(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE));
+        CHECKED(db.exec("CREATE TABLE t (a INTEGER, b REAL, s TEXT)"));
+        auto stmt = CHECKED(db.prepare("INSERT INTO t(a, b, s) VALUES(?, ?, ?)"));
+        CHECKED(db.exec("BEGIN"));
+        for (int i = 0; i < k_num_rows; ++i) {
+            CHECKED(stmt.execute(i, i * 0.5, "some text"));
+        }
+        CHECKED(db.exec("COMMIT"));
+    }
+    const std::pair<const char*, sqlite::open_options> read_presets[] = {
+      {"preset default: scan 1000 rows", sqlite::open_options{.flags = SQLITE_OPEN_READONLY}},
+      {"preset read_only_mmap: scan 1000 rows", sqlite::open_options::read_only_mmap()},
+    };
+    for (auto& [name, options] : read_presets) {
+        auto db = CHECKED(sqlite::open(path, options));
+        auto stmt = CHECKED(db.prepare("SELECT a, b, s FROM t"));
+        r.run(name, [&] {
+            auto u = stmt.unchecked();
+            while (CHECKED(stmt.step()) == sqlite::step_result::row) {
+                do_not_optimize(u.column_int64(0));
+                do_not_optimize(u.column_double(1));
+                do_not_optimize(u.column_text(2));
+            }
+            CHECKED(stmt.reset());
+        });
+    }
+    remove_database(path);
+}
+
+void bench_allocator_workload(runner& r, const std::string& prefix)
+{
+    auto db = open_test_database();
+    r.run(prefix + ": prepare + step + finalize", [&] {
+        auto stmt = CHECKED(db.prepare("SELECT a, b, s FROM t WHERE a = ?"));
+        CHECKED(stmt.bind_int(1, 42));
+        do_not_optimize(CHECKED(stmt.step()));
+    });
+    CHECKED(db.exec("CREATE TABLE u (a INTEGER, s TEXT)"));
+    auto stmt = CHECKED(db.prepare("INSERT INTO u(a, s) VALUES(?, ?)"));
+    int i = 0;
+    CHECKED(db.exec("BEGIN"));
+    r.run(prefix + ": insert", [&] {
+        do_not_optimize(CHECKED(stmt.execute(++i, "some text")));
+    });
+    CHECKED(db.exec("COMMIT"));
+}
+
+void bench_allocators(runner& r)
+{
+    bench_allocator_workload(r, "allocator default");
+    CHECKED(sqlite::install_pool_allocator());
+    bench_allocator_workload(r, "allocator pool");
+    CHECKED(sqlite::restore_default_allocator());
+}
+
+} // namespace
+
+// Not inlined, like operator delete, to keep GCC from matching the inlined malloc() and free() against the replaced
+// operators (-Wmismatched-new-delete).
+[[gnu::noinline]] void* operator new(std::size_t size)
+{
+    g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t iterations = 0;
+    std::string_view filter;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::stoul(argv[++i]);
+        } else {
+            filter = arg;
+        }
+    }
+
+    std::printf(
+      "sqlitecpp-thin-%s, SQLite %s\n\n", SQLITECPPTHIN_BENCH_EXPECTED ? "expected" : "exception", sqlite3_libversion()
+    );
+
+    try {
+        runner r(iterations, filter);
+        {
+            auto db = open_test_database();
+            bench_prepare(r, db);
+            bench_bind(r, db);
+            bench_step(r, db);
+            bench_column(r, db);
+            bench_scan(r, db);
+            bench_insert(r, db);
+            bench_functions(r, db);
+            bench_span_table(r, db);
+            bench_bind_array(r, db);
+            bench_transaction(r, db);
+        }
+        bench_open_presets(r);
+        bench_write_queue(r);
+        bench_checkpointer(r);
+        // Changes the process-wide SQLite allocator, must run when no database is open.
+        bench_allocators(r);
+        return EXIT_SUCCESS;
+    } catch (std::exception& e) {
+        std::fprintf(stderr, "Exception: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+}
@@ -62,15 +62,9 @@ size_t int_storage_test(const std::vector<AI3>& data, bool use_int64)
         {
             auto stmt = db.prepare("INSERT INTO integers(a, b, c) VALUES(?, ?, ?)");
             for (auto& r : data) {
-                for (size_t i = 0; i < 3; ++i) {
-                    if (use_int64) {
-                        stmt.bind_int(int(i + 1), int64_t(r[i]));
-                    } else {
-                        stmt.bind_int(int(i + 1), r[i]);
-                    }
-                }
-                assert(stmt.step_done_changes() == 1);
-                stmt.reset();
+                [[maybe_unused]] int changes = use_int64 ? stmt.execute(int64_t(r[0]), int64_t(r[1]), int64_t(r[2]))
+                                                         : stmt.execute(r[0], r[1], r[2]);
+                assert(changes == 1);
             }
         }
 
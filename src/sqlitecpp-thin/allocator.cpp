@@ -0,0 +1,726 @@
+#include "allocator.hpp"
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace sqlite
+{
+
+namespace
+{
+// Each allocation is preceded by a header which keeps the user memory 16-byte aligned.
+struct alignas(16) header {
+    uint32_t size_class;
+    uint32_t reserved;
+    // Including the header.
+    uint64_t block_size;
+};
+
+constexpr size_t k_header_size = sizeof(header);
+static_assert(k_header_size == 16);
+
+// 16-byte steps up to 128 bytes, then 4 classes per power of two up to `k_max_block_size`.
+constexpr size_t k_num_linear_classes = 8;
+constexpr size_t k_num_classes = k_num_linear_classes + 4 * 8;
+constexpr size_t k_max_block_size = 32768;
+constexpr uint32_t k_large_class = UINT32_MAX;
+constexpr size_t k_chunk_size = 65536;
+
+uint32_t size_class_of(size_t block_size)
+{
+    if (block_size <= 128) {
+        return uint32_t((block_size + 15) / 16 - 1);
+    }
+    if (block_size > k_max_block_size) {
+        return k_large_class;
+    }
+    auto p = std::bit_width(block_size - 1);
+    auto sub = ((block_size - 1) >> (p - 3)) & 3;
+    return uint32_t(k_num_linear_classes + (p - 8) * 4 + sub);
+}
+
+size_t class_block_size(size_t c)
+{
+    if (c < k_num_linear_classes) {
+        return (c + 1) * 16;
+    }
+    auto p = (c - k_num_linear_classes) / 4 + 8;
+    auto sub = (c - k_num_linear_classes) % 4;
+    return (5 + sub) << (p - 3);
+}
+
+header* header_of(void* p)
+{
+    return reinterpret_cast<header*>(static_cast<std::byte*>(p) - k_header_size);
+}
+
+void* user_memory_of(header* h)
+{
+    return reinterpret_cast<std::byte*>(h) + k_header_size;
+}
+
+int int_usable_size(uint64_t block_size)
+{
+    return int(block_size - k_header_size);
+}
+
+// Statistics
+
+// Threshold of flushing the per-thread byte counts to the global one, it's the precision of `peak_bytes`.
+constexpr int64_t k_bytes_flush_threshold = 64 * 1024;
+
+// Counters of a thread, written only by the owner thread, read by `get_allocator_stats()`. The owner updates them with
+// a relaxed load and store, without locked instructions. A block may be freed by another thread than the one which
+// allocated it, so the `in_use` and `pending_bytes` counters of a thread can wrap around, only their sums are
+// meaningful.
+struct local_stats {
+    local_stats()
+        : allocations()
+        , in_use()
+        , large_allocations(0)
+        , large_in_use(0)
+        , pending_bytes(0)
+    {
+    }
+
+    std::array<std::atomic<uint64_t>, k_num_classes> allocations;
+    std::array<std::atomic<uint64_t>, k_num_classes> in_use;
+    std::atomic<uint64_t> large_allocations;
+    std::atomic<uint64_t> large_in_use;
+    // Not yet added to `global_stats::current_bytes`.
+    std::atomic<uint64_t> pending_bytes;
+
+    static void add(std::atomic<uint64_t>& x, uint64_t d)
+    {
+        x.store(x.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        for (size_t c = 0; c < k_num_classes; ++c) {
+            allocations[c].store(0, std::memory_order_relaxed);
+            in_use[c].store(0, std::memory_order_relaxed);
+        }
+        large_allocations.store(0, std::memory_order_relaxed);
+        large_in_use.store(0, std::memory_order_relaxed);
+        pending_bytes.store(0, std::memory_order_relaxed);
+    }
+
+    void on_allocate(uint32_t c, uint64_t bytes);
+    void on_deallocate(uint32_t c, uint64_t bytes);
+
+    void add_to(local_stats& y) const
+    {
+        for (size_t c = 0; c < k_num_classes; ++c) {
+            add(y.allocations[c], allocations[c].load(std::memory_order_relaxed));
+            add(y.in_use[c], in_use[c].load(std::memory_order_relaxed));
+        }
+        add(y.large_allocations, large_allocations.load(std::memory_order_relaxed));
+        add(y.large_in_use, large_in_use.load(std::memory_order_relaxed));
+        add(y.pending_bytes, pending_bytes.load(std::memory_order_relaxed));
+    }
+};
+
+struct thread_cache;
+
+struct global_stats {
+    global_stats()
+        : mutex()
+        , threads()
+        , retired()
+        , current_bytes(0)
+        , peak_bytes(0)
+    {
+    }
+
+    // Guards `threads` and `retired`.
+    std::mutex mutex;
+    std::vector<thread_cache*> threads;
+    // Counters of the exited threads.
+    local_stats retired;
+    std::atomic<uint64_t> current_bytes;
+    std::atomic<uint64_t> peak_bytes;
+
+    void add_bytes(uint64_t bytes)
+    {
+        auto current = current_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        auto peak = peak_bytes.load(std::memory_order_relaxed);
+        while (int64_t(current) > int64_t(peak)
+               && !peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+// Never destroyed: SQLite may free memory during the static destruction.
+global_stats& g_stats = *new global_stats();
+
+void local_stats::on_allocate(uint32_t c, uint64_t bytes)
+{
+    if (c == k_large_class) {
+        add(large_allocations, 1);
+        add(large_in_use, 1);
+    } else {
+        add(allocations[c], 1);
+        add(in_use[c], 1);
+    }
+    auto pending = pending_bytes.load(std::memory_order_relaxed) + bytes;
+    if (int64_t(pending) >= k_bytes_flush_threshold) {
+        g_stats.add_bytes(pending);
+        pending = 0;
+    }
+    pending_bytes.store(pending, std::memory_order_relaxed);
+}
+
+void local_stats::on_deallocate(uint32_t c, uint64_t bytes)
+{
+    if (c == k_large_class) {
+        add(large_in_use, uint64_t(-1));
+    } else {
+        add(in_use[c], uint64_t(-1));
+    }
+    auto pending = pending_bytes.load(std::memory_order_relaxed) - bytes;
+    if (int64_t(pending) <= -k_bytes_flush_threshold) {
+        g_stats.add_bytes(pending);
+        pending = 0;
+    }
+    pending_bytes.store(pending, std::memory_order_relaxed);
+}
+
+// Pool allocator
+
+struct free_block {
+    free_block* next;
+};
+
+struct free_list {
+    free_block* head = nullptr;
+    size_t count = 0;
+
+    void push(free_block* b)
+    {
+        b->next = head;
+        head = b;
+        ++count;
+    }
+
+    free_block* pop()
+    {
+        auto* b = head;
+        head = b->next;
+        --count;
+        return b;
+    }
+};
+
+struct pool {
+    pool()
+        : generation(1)
+        , thread_cache_blocks(0)
+        , central()
+        , chunks_mutex()
+        , chunks()
+    {
+    }
+
+    struct alignas(64) central_list {
+        central_list()
+            : mutex()
+            , blocks()
+        {
+        }
+
+        std::mutex mutex;
+        free_list blocks;
+    };
+
+    // Incremented when the allocator is (re)installed or replaced, the thread caches and statistics of older
+    // generations are dropped.
+    std::atomic<uint64_t> generation;
+    size_t thread_cache_blocks;
+    std::array<central_list, k_num_classes> central;
+    std::mutex chunks_mutex;
+    std::vector<void*> chunks;
+
+    // Move up to `n` blocks of class `c` to `to`, carve a new chunk if needed. Return false if out of memory.
+    bool take(size_t c, size_t n, free_list& to)
+    {
+        auto& cl = central[c];
+        std::lock_guard lock(cl.mutex);
+        if (cl.blocks.count == 0) {
+            auto* chunk = static_cast<std::byte*>(std::malloc(k_chunk_size));
+            if (!chunk) {
+                return false;
+            }
+            {
+                std::lock_guard chunks_lock(chunks_mutex);
+                chunks.push_back(chunk);
+            }
+            auto block_size = class_block_size(c);
+            for (size_t offset = 0; offset + block_size <= k_chunk_size; offset += block_size) {
+                cl.blocks.push(reinterpret_cast<free_block*>(chunk + offset));
+            }
+        }
+        for (size_t i = 0; i < n && cl.blocks.count > 0; ++i) {
+            to.push(cl.blocks.pop());
+        }
+        return true;
+    }
+
+    void give_back(size_t c, size_t n, free_list& from)
+    {
+        auto& cl = central[c];
+        std::lock_guard lock(cl.mutex);
+        for (size_t i = 0; i < n && from.count > 0; ++i) {
+            cl.blocks.push(from.pop());
+        }
+    }
+
+    // Free all chunks and reset the statistics. Call only when SQLite is shut down and the allocator is replaced.
+    void release_all()
+    {
+        generation.fetch_add(1);
+        for (auto& cl : central) {
+            std::lock_guard lock(cl.mutex);
+            cl.blocks = free_list();
+        }
+        {
+            std::lock_guard chunks_lock(chunks_mutex);
+            for (auto* chunk : chunks) {
+                std::free(chunk);
+            }
+            chunks.clear();
+        }
+        std::lock_guard stats_lock(g_stats.mutex);
+        g_stats.retired.clear();
+        g_stats.current_bytes = 0;
+        g_stats.peak_bytes = 0;
+    }
+};
+
+pool& g_pool = *new pool();
+
+struct thread_cache {
+    thread_cache()
+        : generation(0)
+        , registered(false)
+        , destroyed(false)
+        , lists()
+        , stats()
+    {
+    }
+
+    ~thread_cache()
+    {
+        std::lock_guard lock(g_stats.mutex);
+        if (registered) {
+            std::erase(g_stats.threads, this);
+        }
+        if (generation.load(std::memory_order_relaxed) == g_pool.generation.load()) {
+            stats.add_to(g_stats.retired);
+            for (size_t c = 0; c < k_num_classes; ++c) {
+                g_pool.give_back(c, lists[c].count, lists[c]);
+            }
+        }
+        // SQLite may still be called from the destructors of other thread-local objects.
+        destroyed = true;
+    }
+
+    thread_cache(const thread_cache&) = delete;
+    thread_cache& operator=(const thread_cache&) = delete;
+
+    std::atomic<uint64_t> generation;
+    bool registered;
+    bool destroyed;
+    std::array<free_list, k_num_classes> lists;
+    local_stats stats;
+
+    // Drop the blocks and counters of a previous generation.
+    void validate()
+    {
+        auto g = g_pool.generation.load(std::memory_order_relaxed);
+        if (generation.load(std::memory_order_relaxed) != g) {
+            lists = {};
+            stats.clear();
+            generation.store(g, std::memory_order_relaxed);
+            if (!registered) {
+                std::lock_guard lock(g_stats.mutex);
+                g_stats.threads.push_back(this);
+                registered = true;
+            }
+        }
+    }
+};
+
+thread_local thread_cache t_cache;
+
+// Return the cache of the calling thread, or nullptr if it has been destroyed.
+thread_cache* get_thread_cache()
+{
+    auto* tc = &t_cache;
+    if (tc->destroyed) {
+        return nullptr;
+    }
+    tc->validate();
+    return tc;
+}
+
+void record_allocate(thread_cache* tc, uint32_t c, uint64_t bytes)
+{
+    if (tc) {
+        tc->stats.on_allocate(c, bytes);
+    } else {
+        std::lock_guard lock(g_stats.mutex);
+        g_stats.retired.on_allocate(c, bytes);
+    }
+}
+
+void record_deallocate(thread_cache* tc, uint32_t c, uint64_t bytes)
+{
+    if (tc) {
+        tc->stats.on_deallocate(c, bytes);
+    } else {
+        std::lock_guard lock(g_stats.mutex);
+        g_stats.retired.on_deallocate(c, bytes);
+    }
+}
+
+void* pool_allocate_block(thread_cache* tc, uint32_t c)
+{
+    if (!tc || g_pool.thread_cache_blocks == 0) {
+        free_list one;
+        if (!g_pool.take(c, 1, one)) {
+            return nullptr;
+        }
+        return one.pop();
+    }
+    auto& list = tc->lists[c];
+    if (list.count == 0 && !g_pool.take(c, std::max<size_t>(g_pool.thread_cache_blocks / 2, 1), list)) {
+        return nullptr;
+    }
+    return list.pop();
+}
+
+void pool_deallocate_block(thread_cache* tc, uint32_t c, void* p)
+{
+    auto* b = static_cast<free_block*>(p);
+    if (!tc || g_pool.thread_cache_blocks == 0) {
+        free_list one;
+        one.push(b);
+        g_pool.give_back(c, 1, one);
+        return;
+    }
+    auto& list = tc->lists[c];
+    list.push(b);
+    if (list.count > g_pool.thread_cache_blocks) {
+        g_pool.give_back(c, list.count / 2, list);
+    }
+}
+
+void* pool_malloc(int n)
+{
+    auto* tc = get_thread_cache();
+    auto block_size = size_t(n) + k_header_size;
+    auto c = size_class_of(block_size);
+    void* p{};
+    if (c == k_large_class) {
+        p = std::malloc(block_size);
+    } else {
+        block_size = class_block_size(c);
+        p = pool_allocate_block(tc, c);
+    }
+    if (!p) {
+        return nullptr;
+    }
+    auto* h = new (p) header{.size_class = c, .reserved = 0, .block_size = block_size};
+    record_allocate(tc, c, block_size);
+    return user_memory_of(h);
+}
+
+void pool_free(void* p)
+{
+    auto* tc = get_thread_cache();
+    auto* h = header_of(p);
+    record_deallocate(tc, h->size_class, h->block_size);
+    if (h->size_class == k_large_class) {
+        std::free(h);
+    } else {
+        pool_deallocate_block(tc, h->size_class, h);
+    }
+}
+
+void* pool_realloc(void* p, int n)
+{
+    auto* h = header_of(p);
+    if (h->size_class != k_large_class && size_class_of(size_t(n) + k_header_size) == h->size_class) {
+        return p;
+    }
+    auto* q = pool_malloc(n);
+    if (!q) {
+        return nullptr;
+    }
+    std::memcpy(q, p, std::min<size_t>(size_t(n), h->block_size - k_header_size));
+    pool_free(p);
+    return q;
+}
+
+int pool_size(void* p)
+{
+    return int_usable_size(header_of(p)->block_size);
+}
+
+int pool_roundup(int n)
+{
+    auto block_size = size_t(n) + k_header_size;
+    auto c = size_class_of(block_size);
+    if (c == k_large_class) {
+        return int((size_t(n) + 15) & ~size_t(15));
+    }
+    return int_usable_size(class_block_size(c));
+}
+
+int pool_init(void*)
+{
+    return SQLITE_OK;
+}
+
+void pool_shutdown(void*)
+{
+    // Any sqlite3_shutdown() calls this, even with connections still open. The chunks are released only when the
+    // functions below replace the allocator.
+}
+
+// Adapter of a std::pmr::memory_resource
+
+std::pmr::memory_resource* g_resource = nullptr;
+
+void* resource_malloc(int n)
+{
+    auto block_size = (size_t(n) + k_header_size + 15) & ~size_t(15);
+    void* p{};
+    try {
+        p = g_resource->allocate(block_size, 16);
+    } catch (...) {
+        return nullptr;
+    }
+    auto c = size_class_of(block_size);
+    auto* h = new (p) header{.size_class = c, .reserved = 0, .block_size = block_size};
+    record_allocate(get_thread_cache(), c, block_size);
+    return user_memory_of(h);
+}
+
+void resource_free(void* p)
+{
+    auto* h = header_of(p);
+    record_deallocate(get_thread_cache(), h->size_class, h->block_size);
+    g_resource->deallocate(h, h->block_size, 16);
+}
+
+void* resource_realloc(void* p, int n)
+{
+    auto* h = header_of(p);
+    if (((size_t(n) + k_header_size + 15) & ~size_t(15)) == h->block_size) {
+        return p;
+    }
+    auto* q = resource_malloc(n);
+    if (!q) {
+        return nullptr;
+    }
+    std::memcpy(q, p, std::min<size_t>(size_t(n), h->block_size - k_header_size));
+    resource_free(p);
+    return q;
+}
+
+int resource_size(void* p)
+{
+    return int_usable_size(header_of(p)->block_size);
+}
+
+int resource_roundup(int n)
+{
+    return int((size_t(n) + 15) & ~size_t(15));
+}
+
+int resource_init(void*)
+{
+    return SQLITE_OK;
+}
+
+void resource_shutdown(void*) {}
+
+// The allocator before the first install.
+optional<sqlite3_mem_methods> g_default_methods;
+
+// Call after sqlite3_shutdown().
+expected<void, error> install_mem_methods(const sqlite3_mem_methods& methods)
+{
+    g_pool.release_all();
+    if (!g_default_methods) {
+        sqlite3_mem_methods m{};
+        if (int rc = sqlite3_config(SQLITE_CONFIG_GETMALLOC, &m)) {
+            RETURN_UNEXPECTED(create_error_for_rc(rc));
+        }
+        g_default_methods = m;
+    }
+    if (int rc = sqlite3_config(SQLITE_CONFIG_MALLOC, &methods)) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    RETURN_VOID;
+}
+
+// Owned by the library, replaced by `config_pagecache()`. Never freed otherwise, like `g_pool`: SQLite may use it
+// during the static destruction.
+std::byte* g_pagecache_slab = nullptr;
+
+expected<int, error> pagecache_header_size()
+{
+    int size{};
+    if (int rc = sqlite3_config(SQLITE_CONFIG_PCACHE_HDRSZ, &size)) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    return size;
+}
+} // namespace
+
+expected<void, error> install_pool_allocator(const pool_allocator_options& options)
+{
+    static const sqlite3_mem_methods methods{
+      .xMalloc = &pool_malloc,
+      .xFree = &pool_free,
+      .xRealloc = &pool_realloc,
+      .xSize = &pool_size,
+      .xRoundup = &pool_roundup,
+      .xInit = &pool_init,
+      .xShutdown = &pool_shutdown,
+      .pAppData = nullptr
+    };
+    // Shut down SQLite first, the pool must not be in use when changing its options.
+    if (int rc = sqlite3_shutdown()) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    g_pool.thread_cache_blocks = options.thread_cache_blocks;
+    return install_mem_methods(methods);
+}
+
+expected<void, error> install_allocator(std::pmr::memory_resource* resource)
+{
+    static const sqlite3_mem_methods methods{
+      .xMalloc = &resource_malloc,
+      .xFree = &resource_free,
+      .xRealloc = &resource_realloc,
+      .xSize = &resource_size,
+      .xRoundup = &resource_roundup,
+      .xInit = &resource_init,
+      .xShutdown = &resource_shutdown,
+      .pAppData = nullptr
+    };
+    if (int rc = sqlite3_shutdown()) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    g_resource = resource;
+    return install_mem_methods(methods);
+}
+
+expected<void, error> restore_default_allocator()
+{
+    if (!g_default_methods) {
+        RETURN_VOID;
+    }
+    if (int rc = sqlite3_shutdown()) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    if (int rc = sqlite3_config(SQLITE_CONFIG_MALLOC, &*g_default_methods)) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    g_pool.release_all();
+    RETURN_VOID;
+}
+
+expected<void, error> config_pagecache(int page_size, int num_pages)
+{
+    if (int rc = sqlite3_shutdown()) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    if (num_pages <= 0) {
+        if (int rc = sqlite3_config(SQLITE_CONFIG_PAGECACHE, nullptr, 0, 0)) {
+            RETURN_UNEXPECTED(create_error_for_rc(rc));
+        }
+        delete[] std::exchange(g_pagecache_slab, nullptr);
+        RETURN_VOID;
+    }
+    auto header_size = pagecache_header_size();
+#if SQLITECPPTHIN_EXPECTED
+    if (!header_size) {
+        RETURN_UNEXPECTED(MOVE(header_size.error()));
+    }
+    // Slot sizes must be multiples of 8.
+    int slot_size = (page_size + *header_size + 7) & ~7;
+#else
+    int slot_size = (page_size + header_size + 7) & ~7;
+#endif
+    auto slab = std::make_unique_for_overwrite<std::byte[]>(size_t(slot_size) * size_t(num_pages));
+    if (int rc = sqlite3_config(SQLITE_CONFIG_PAGECACHE, slab.get(), slot_size, num_pages)) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    delete[] std::exchange(g_pagecache_slab, slab.release());
+    RETURN_VOID;
+}
+
+expected<void, error> config_lookaside(int slot_size, int slot_count)
+{
+    if (int rc = sqlite3_shutdown()) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    if (int rc = sqlite3_config(SQLITE_CONFIG_LOOKASIDE, slot_size, slot_count)) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    RETURN_VOID;
+}
+
+allocator_stats get_allocator_stats()
+{
+    local_stats sum;
+    uint64_t current_bytes = 0;
+    uint64_t peak_bytes = 0;
+    {
+        std::lock_guard lock(g_stats.mutex);
+        g_stats.retired.add_to(sum);
+        auto g = g_pool.generation.load();
+        for (auto* tc : g_stats.threads) {
+            if (tc->generation.load(std::memory_order_relaxed) == g) {
+                tc->stats.add_to(sum);
+            }
+        }
+        current_bytes = g_stats.current_bytes.load(std::memory_order_relaxed);
+        peak_bytes = g_stats.peak_bytes.load(std::memory_order_relaxed);
+    }
+
+    allocator_stats s;
+    s.size_classes.reserve(k_num_classes);
+    for (size_t c = 0; c < k_num_classes; ++c) {
+        s.size_classes.push_back(allocator_size_class_stats{
+          .block_size = class_block_size(c),
+          .allocations = sum.allocations[c].load(std::memory_order_relaxed),
+          .in_use = sum.in_use[c].load(std::memory_order_relaxed)
+        });
+    }
+    s.large = allocator_size_class_stats{
+      .block_size = 0,
+      .allocations = sum.large_allocations.load(std::memory_order_relaxed),
+      .in_use = sum.large_in_use.load(std::memory_order_relaxed)
+    };
+    s.current_bytes = current_bytes + sum.pending_bytes.load(std::memory_order_relaxed);
+    s.peak_bytes = std::max(peak_bytes, s.current_bytes);
+    return s;
+}
+
+} // namespace sqlite
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <memory_resource>
+
+namespace sqlite
+{
+
+// Process-wide memory allocators for SQLite, installed with sqlite3_config(SQLITE_CONFIG_MALLOC), and the related
+// memory settings.
+//
+// SQLite can change these settings only while it is not initialized, so these functions call sqlite3_shutdown() first:
+// they must be called when no database connections are open and no other thread uses SQLite, typically at the
+// start of `main()`. The next `open()` initializes SQLite again.
+
+struct pool_allocator_options {
+    // Maximum number of free blocks per size class cached by each thread. Zero disables the thread caches.
+    size_t thread_cache_blocks = 64;
+};
+
+// Install the built-in allocator: size classes up to 32 KiB with thread-local caches of free blocks. The blocks are
+// carved from 64 KiB chunks, which are returned to the system only when the allocator is installed again or replaced
+// by the functions below, never at exit. Larger allocations go to malloc().
+expected<void, error> install_pool_allocator(const pool_allocator_options& options = {});
+
+// Install an allocator forwarding to `resource`, which must be thread-safe and must outlive the use of SQLite, until
+// `restore_default_allocator()` or the end of the process.
+expected<void, error> install_allocator(std::pmr::memory_resource* resource);
+
+// Restore the allocator which was in place before the first `install_*()` call.
+expected<void, error> restore_default_allocator();
+
+// sqlite3_config(SQLITE_CONFIG_PAGECACHE): preallocate a slab of `num_pages` page cache slots for pages up to
+// `page_size` bytes (the slot size includes the SQLITE_CONFIG_PCACHE_HDRSZ header). The slab is owned by the library
+// and freed only when replaced, never at exit. The page cache falls back to the allocator when it's full. Zero
+// `num_pages` removes the slab. Check the utilization with sqlite3_status(SQLITE_STATUS_PAGECACHE_USED) and
+// SQLITE_STATUS_PAGECACHE_OVERFLOW.
+expected<void, error> config_pagecache(int page_size, int num_pages);
+
+// sqlite3_config(SQLITE_CONFIG_LOOKASIDE): the default lookaside of the connections opened afterwards, see also
+// `database::db_config_lookaside()`.
+expected<void, error> config_lookaside(int slot_size, int slot_count);
+
+struct allocator_size_class_stats {
+    // Block size, including the 16-byte header of each allocation.
+    size_t block_size = 0;
+    // Number of allocations since the allocator was installed.
+    uint64_t allocations = 0;
+    // Number of blocks currently allocated.
+    uint64_t in_use = 0;
+};
+
+// Statistics of the allocator installed by this library, since it was installed. The counters are kept per thread and
+// summed here. The allocations through `install_allocator()` are counted in the same size classes as the pool
+// allocator's.
+struct allocator_stats {
+    std::vector<allocator_size_class_stats> size_classes = {};
+    // Allocations larger than the largest size class.
+    allocator_size_class_stats large = {};
+    // Bytes currently allocated, including the headers and the unused part of the blocks.
+    uint64_t current_bytes = 0;
+    // The threads add their byte counts to the global one in 64 KiB steps, the peak is accurate to that precision.
+    uint64_t peak_bytes = 0;
+};
+
+allocator_stats get_allocator_stats();
+
+} // namespace sqlite
@@ -0,0 +1,140 @@
+#include "async.hpp"
+
+#include "common.hpp"
+
+#include <semaphore>
+#include <thread>
+
+namespace sqlite
+{
+
+struct executor::impl {
+    impl()
+        : mutex()
+        , tasks()
+        , num_tasks(0)
+        , threads()
+    {
+    }
+
+    void worker()
+    {
+        for (;;) {
+            num_tasks.acquire();
+            std::move_only_function<void()> task;
+            {
+                std::lock_guard lock(mutex);
+                if (tasks.empty()) {
+                    // Only `~executor()` releases the semaphore without a task.
+                    return;
+                }
+                task = MOVE(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::deque<std::move_only_function<void()>> tasks;
+    std::counting_semaphore<> num_tasks;
+    std::vector<std::thread> threads;
+};
+
+executor::executor(size_t num_threads)
+    : _impl(std::make_unique<impl>())
+{
+    _impl->threads.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        _impl->threads.emplace_back([impl = _impl.get()] {
+            impl->worker();
+        });
+    }
+}
+
+executor::~executor()
+{
+    _impl->num_tasks.release(std::ptrdiff_t(_impl->threads.size()));
+    for (auto& t : _impl->threads) {
+        t.join();
+    }
+}
+
+void executor::post(std::move_only_function<void()> task)
+{
+    {
+        std::lock_guard lock(_impl->mutex);
+        _impl->tasks.push_back(MOVE(task));
+    }
+    _impl->num_tasks.release();
+}
+
+async_database::async_database(database&& db, executor& ex)
+    : _db(MOVE(db))
+    , _executor(ex)
+    , _mutex()
+    , _tasks()
+    , _running(false)
+    , _num_pending(0)
+{
+}
+
+async_database::~async_database()
+{
+    for (auto n = _num_pending.load(); n > 0; n = _num_pending.load()) {
+        _num_pending.wait(n);
+    }
+    // Wait until `run_next_task()` which decremented `_num_pending` to zero releases the mutex.
+    std::lock_guard lock(_mutex);
+}
+
+void async_database::post(std::move_only_function<void()> task)
+{
+    ++_num_pending;
+    std::lock_guard lock(_mutex);
+    _tasks.push_back(MOVE(task));
+    if (!_running) {
+        _running = true;
+        _executor.post([this] {
+            run_next_task();
+        });
+    }
+}
+
+void async_database::run_next_task()
+{
+    std::move_only_function<void()> task;
+    {
+        std::lock_guard lock(_mutex);
+        task = MOVE(_tasks.front());
+        _tasks.pop_front();
+    }
+    task();
+    std::lock_guard lock(_mutex);
+    if (_tasks.empty()) {
+        _running = false;
+    } else {
+        _executor.post([this] {
+            run_next_task();
+        });
+    }
+    --_num_pending;
+    _num_pending.notify_all();
+}
+
+expected<int, current_error> async_database::step_all(statement& stmt)
+{
+    for (;;) {
+        auto sr = stmt.step();
+#if SQLITECPPTHIN_EXPECTED
+        if (!sr) {
+            RETURN_UNEXPECTED(sr.error());
+        }
+#endif
+        if (sr == step_result::done) {
+            return sqlite3_changes(stmt.db_handle());
+        }
+    }
+}
+
+} // namespace sqlite
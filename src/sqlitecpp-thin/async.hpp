@@ -0,0 +1,228 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace sqlite
+{
+
+// Worker threads running the blocking SQLite calls of `async_database`.
+class executor
+{
+public:
+    explicit executor(size_t num_threads);
+
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+
+    // Run the remaining tasks, then join the threads.
+    ~executor();
+
+    void post(std::move_only_function<void()> task);
+
+private:
+    struct impl;
+    std::unique_ptr<impl> _impl;
+};
+
+// Result of the awaitables of `async_database`:
+// - `expected<T, current_error>` results become `expected<T, error>` since the `current_error` is not valid outside
+//   the worker thread.
+// - Exceptions (the only way of error reporting in the exception-style lib) are rethrown in the awaiting coroutine.
+template<class R>
+struct async_result {
+    using type = R;
+};
+
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+template<class T>
+struct async_result<std::expected<T, current_error>> {
+    using type = std::expected<T, error>;
+};
+#endif
+
+template<class R>
+using async_result_t = typename async_result<R>::type;
+
+// A `database` which is used from coroutines. The blocking calls run on the executor, the calls on the same
+// connection are serialized. The coroutine is resumed on an executor thread.
+//
+//     auto changes = co_await adb.async_exec_changes("DELETE FROM foo WHERE a = 22");
+//
+class async_database
+{
+public:
+    // `ex` must outlive this object.
+    async_database(database&& db, executor& ex);
+
+    async_database(const async_database&) = delete;
+    async_database& operator=(const async_database&) = delete;
+
+    // Waits for the pending calls.
+    ~async_database();
+
+    // Awaitable returned by the functions below.
+    template<class F>
+    class operation
+    {
+    public:
+        using result_type = async_result_t<std::invoke_result_t<F&, database&>>;
+
+        operation(async_database* adb, F f)
+            : _adb(adb)
+            , _f(std::move(f))
+            , _result()
+            , _exception()
+        {
+        }
+
+        operation(const operation&) = delete;
+        operation& operator=(const operation&) = delete;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            _adb->post([this, h] {
+                try {
+                    run();
+                } catch (...) {
+                    _exception = std::current_exception();
+                }
+                _adb->_executor.post([h] { h.resume(); });
+            });
+        }
+
+        result_type await_resume()
+        {
+            if (_exception) {
+                std::rethrow_exception(_exception);
+            }
+            if constexpr (!std::is_void_v<result_type>) {
+                return std::move(*_result);
+            }
+        }
+
+    private:
+        void run()
+        {
+            if constexpr (std::is_void_v<result_type>) {
+                _f(_adb->_db);
+            } else if constexpr (std::is_same_v<result_type, std::invoke_result_t<F&, database&>>) {
+                _result.emplace(_f(_adb->_db));
+            } else {
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+                // expected<T, current_error> -> expected<T, error>
+                auto r = _f(_adb->_db);
+                if (r) {
+                    if constexpr (std::is_void_v<typename result_type::value_type>) {
+                        _result.emplace();
+                    } else {
+                        _result.emplace(std::move(*r));
+                    }
+                } else {
+                    _result.emplace(std::unexpected(r.error().get_error()));
+                }
+#endif
+            }
+        }
+
+        using storage_type = std::conditional_t<std::is_void_v<result_type>, bool, result_type>;
+
+        async_database* _adb;
+        F _f;
+        optional<storage_type> _result;
+        std::exception_ptr _exception;
+    };
+
+    // Run `f(database&)` on the executor. Use this for anything not covered by the functions below.
+    template<class F>
+    operation<std::decay_t<F>> run(F&& f)
+    {
+        return operation<std::decay_t<F>>(this, std::forward<F>(f));
+    }
+
+    // database::exec() on the executor.
+    auto async_exec(string sql)
+    {
+        return run([sql = std::move(sql)](database& db) {
+            return db.exec(sql);
+        });
+    }
+
+    // database::exec_changes() on the executor.
+    auto async_exec_changes(string sql)
+    {
+        return run([sql = std::move(sql)](database& db) {
+            return db.exec_changes(sql);
+        });
+    }
+
+    // Step `stmt` until SQLITE_DONE and return sqlite3_changes(). `stmt` must belong to this database and must be kept
+    // alive until the operation completes.
+    auto async_step_all(statement& stmt)
+    {
+        return run([&stmt](database&) {
+            return step_all(stmt);
+        });
+    }
+
+    // Step `stmt` until SQLITE_DONE and collect the rows. The column types must own their values (e.g. `string`
+    // instead of `string_view`) since the rows are returned after the last step.
+    template<class... Ts>
+        requires(!std::is_same_v<Ts, string_view> && ...) && (!std::is_same_v<Ts, span<const byte>> && ...)
+    auto async_fetch_all(statement& stmt)
+    {
+        return run([&stmt](database&) {
+            std::vector<std::tuple<Ts...>> result;
+            auto rows = stmt.rows<Ts...>();
+            for (auto& row : rows) {
+                result.push_back(row);
+            }
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+            if (auto& e = rows.get_error()) {
+                return std::expected<decltype(result), error>(std::unexpected(*e));
+            }
+            return std::expected<decltype(result), error>(std::move(result));
+#else
+            return result;
+#endif
+        });
+    }
+
+    // Direct access to the connection, only when there are no pending operations.
+    database& get()
+    {
+        return _db;
+    }
+
+private:
+    // Runs the tasks of the connection one at a time on the executor.
+    void post(std::move_only_function<void()> task);
+    void run_next_task();
+
+    static expected<int, current_error> step_all(statement& stmt);
+
+    database _db;
+    executor& _executor;
+
+    std::mutex _mutex;
+    std::deque<std::move_only_function<void()>> _tasks;
+    bool _running;
+    // Queued and running tasks.
+    std::atomic<size_t> _num_pending;
+};
+
+} // namespace sqlite
@@ -0,0 +1,184 @@
+#include "backup.hpp"
+
+#include "common.hpp"
+
+#include <thread>
+
+namespace sqlite
+{
+
+backup::backup(sqlite3_backup* b, sqlite3* dest_db)
+    : _backup(b)
+    , _dest_db(dest_db)
+    , _rc(SQLITE_OK)
+    , _remaining(0)
+    , _pagecount(0)
+{
+}
+
+backup::backup(backup&& y)
+    : _backup(y._backup)
+    , _dest_db(y._dest_db)
+    , _rc(y._rc)
+    , _remaining(y._remaining)
+    , _pagecount(y._pagecount)
+{
+    y._backup = nullptr;
+}
+
+backup& backup::operator=(backup&& y)
+{
+    auto was_this = MOVE(*this);
+    std::swap(_backup, y._backup);
+    std::swap(_dest_db, y._dest_db);
+    std::swap(_rc, y._rc);
+    std::swap(_remaining, y._remaining);
+    std::swap(_pagecount, y._pagecount);
+    return *this;
+}
+
+backup::~backup()
+{
+    if (_backup) {
+        sqlite3_backup_finish(_backup);
+    }
+}
+
+int backup::finish_rc()
+{
+    _remaining = sqlite3_backup_remaining(_backup);
+    _pagecount = sqlite3_backup_pagecount(_backup);
+    _rc = sqlite3_backup_finish(std::exchange(_backup, nullptr));
+    return _rc;
+}
+
+expected<int, current_error> backup::step_rc(int num_pages)
+{
+    if (!_backup) {
+        // Failed by a previous step, stepping a finished backup is a misuse.
+        assert(_rc != SQLITE_OK);
+        RETURN_UNEXPECTED(current_error(_rc, _dest_db));
+    }
+    int rc = sqlite3_backup_step(_backup, num_pages);
+    switch (rc) {
+    case SQLITE_DONE:
+    case SQLITE_OK:
+    case SQLITE_BUSY:
+    case SQLITE_LOCKED:
+        return rc;
+    default:
+        // sqlite3_backup_step() doesn't set the error on the destination database, sqlite3_backup_finish() does.
+        RETURN_UNEXPECTED(current_error(finish_rc(), _dest_db));
+    }
+}
+
+expected<bool, current_error> backup::step(int num_pages)
+{
+    auto rc = step_rc(num_pages);
+#if SQLITECPPTHIN_EXPECTED
+    if (!rc) {
+        RETURN_UNEXPECTED(rc.error());
+    }
+    return *rc == SQLITE_DONE;
+#else
+    return rc == SQLITE_DONE;
+#endif
+}
+
+int backup::remaining() const
+{
+    return _backup ? sqlite3_backup_remaining(_backup) : _remaining;
+}
+
+int backup::pagecount() const
+{
+    return _backup ? sqlite3_backup_pagecount(_backup) : _pagecount;
+}
+
+expected<bool, current_error> backup::run(const backup_options& options)
+{
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    double num_pages_copied = 0;
+    // When the steps started returning SQLITE_BUSY or SQLITE_LOCKED.
+    optional<clock::time_point> busy_since;
+    for (;;) {
+        auto rc_or_error = step_rc(options.pages_per_step);
+#if SQLITECPPTHIN_EXPECTED
+        if (!rc_or_error) {
+            RETURN_UNEXPECTED(rc_or_error.error());
+        }
+        int rc = *rc_or_error;
+#else
+        int rc = rc_or_error;
+#endif
+        if (options.progress && !options.progress(remaining(), pagecount())) {
+            return false;
+        }
+        if (rc == SQLITE_DONE) {
+            return true;
+        }
+        if (rc != SQLITE_OK) {
+            // SQLITE_BUSY or SQLITE_LOCKED, nothing was copied.
+            const auto now = clock::now();
+            if (!busy_since) {
+                busy_since = now;
+            } else if (options.max_busy_wait.count() > 0 && now - *busy_since >= options.max_busy_wait) {
+                // sqlite3_backup_finish() returns the error of the last step.
+                RETURN_UNEXPECTED(current_error(finish_rc(), _dest_db));
+            }
+            std::this_thread::sleep_for(options.busy_retry_interval);
+            continue;
+        }
+        busy_since.reset();
+        if (options.max_pages_per_second > 0) {
+            num_pages_copied += double(options.pages_per_step);
+            auto target_elapsed = std::chrono::duration<double>(num_pages_copied / options.max_pages_per_second);
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(target_elapsed));
+        } else {
+            // Let the writers of the source in.
+            std::this_thread::yield();
+        }
+    }
+}
+
+expected<void, current_error> backup::finish()
+{
+    const int rc = _backup ? finish_rc() : _rc;
+    if (rc != SQLITE_OK) {
+        RETURN_UNEXPECTED(current_error(rc, _dest_db));
+    }
+    RETURN_VOID;
+}
+
+expected<backup, current_error>
+start_backup(database& dest, database& source, string_like_zt dest_name, string_like_zt source_name)
+{
+    auto* b = sqlite3_backup_init(dest.handle(), dest_name.c_str(), source.handle(), source_name.c_str());
+    if (!b) {
+        // sqlite3_backup_init() stores the error in the destination database.
+        RETURN_UNEXPECTED(current_error(dest.handle()));
+    }
+    return backup(b, dest.handle());
+}
+
+std::future<expected<bool, error>> run_backup_in_background(backup&& b, backup_options options)
+{
+    return std::async(std::launch::async, [b = MOVE(b), options = MOVE(options)]() mutable -> expected<bool, error> {
+        auto r = b.run(options);
+#if SQLITECPPTHIN_EXPECTED
+        if (!r) {
+            RETURN_UNEXPECTED(r.error().get_error());
+        }
+        if (auto f = b.finish(); !f) {
+            RETURN_UNEXPECTED(f.error().get_error());
+        }
+        return *r;
+#else
+        b.finish();
+        return r;
+#endif
+    });
+}
+
+} // namespace sqlite
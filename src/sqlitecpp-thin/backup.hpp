@@ -0,0 +1,92 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <chrono>
+#include <future>
+
+namespace sqlite
+{
+
+struct backup_options {
+    // Pages copied by one sqlite3_backup_step(). The source is locked only during a step.
+    int pages_per_step = 256;
+    // Throughput limit in pages per second, zero for unlimited. The driver sleeps between the steps to keep the rate.
+    double max_pages_per_second = 0;
+    // Wait before retrying a step which returned SQLITE_BUSY or SQLITE_LOCKED.
+    std::chrono::milliseconds busy_retry_interval = std::chrono::milliseconds(10);
+    // Give up when the steps keep returning SQLITE_BUSY or SQLITE_LOCKED for this long, failing the backup with that
+    // error. Zero retries forever.
+    std::chrono::milliseconds max_busy_wait = std::chrono::milliseconds(0);
+    // Called after each step with sqlite3_backup_remaining() and sqlite3_backup_pagecount(). Return false to stop the
+    // backup early.
+    function<bool(int remaining, int pagecount)> progress = {};
+};
+
+// Online backup of a database into another one, see sqlite3_backup_init().
+//
+// The source is read-locked only during `step()`, so writers on the source stay responsive between the steps. If the
+// source is modified through a different connection during the backup, the next step restarts the copy. Modifications
+// through the source connection itself are applied to the destination on the fly.
+class backup
+{
+public:
+    backup(sqlite3_backup* b, sqlite3* dest_db);
+
+    // `backup` is move-only
+    backup(const backup&) = delete;
+    backup(backup&& y);
+    backup& operator=(const backup&) = delete;
+    backup& operator=(backup&& y);
+
+    // sqlite3_backup_finish(), ignoring the errors.
+    ~backup();
+
+    sqlite3_backup* handle() const
+    {
+        return _backup;
+    }
+
+    // sqlite3_backup_step(), copy up to `num_pages` pages, all remaining pages if negative. Return true when the
+    // backup is complete. SQLITE_BUSY and SQLITE_LOCKED are not errors, the step can be retried. Other errors fail the
+    // backup: the handle is released, and the next steps and `finish()` return the same error.
+    [[nodiscard]] expected<bool, current_error> step(int num_pages);
+
+    // sqlite3_backup_remaining(), valid after the first step. After `finish()` or an error, the value at that point.
+    int remaining() const;
+
+    // sqlite3_backup_pagecount(), valid after the first step. After `finish()` or an error, the value at that point.
+    int pagecount() const;
+
+    // Step until complete, with the pacing, retries and progress reporting of `options`. Return false if the progress
+    // callback stopped the backup.
+    [[nodiscard]] expected<bool, current_error> run(const backup_options& options = {});
+
+    // sqlite3_backup_finish(), release the resources. The result is the error of the last step, if any.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> finish();
+
+private:
+    // sqlite3_backup_step(), return SQLITE_DONE, SQLITE_OK, SQLITE_BUSY or SQLITE_LOCKED.
+    expected<int, current_error> step_rc(int num_pages);
+
+    // sqlite3_backup_finish(), keeping the progress and the result code.
+    int finish_rc();
+
+    sqlite3_backup* _backup;
+    sqlite3* _dest_db;
+    // Result of sqlite3_backup_finish(), and the progress before it.
+    int _rc;
+    int _remaining;
+    int _pagecount;
+};
+
+// sqlite3_backup_init(). The databases must stay alive until the backup is finished.
+expected<backup, current_error>
+start_backup(database& dest, database& source, string_like_zt dest_name = "main", string_like_zt source_name = "main");
+
+// Run the backup on a new thread, see `backup::run()`. The error (or, in the exception-style lib, the exception) is
+// reported through the future. The databases must not be used from other threads unless SQLite is in serialized
+// threading mode, which is the default.
+std::future<expected<bool, error>> run_backup_in_background(backup&& b, backup_options options = {});
+
+} // namespace sqlite
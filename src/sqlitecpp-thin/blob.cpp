@@ -0,0 +1,112 @@
+#include "blob.hpp"
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#define RETURN_UNEXPECTED_ON_ERROR(X)              \
+    if (int rc = (X)) {                            \
+        RETURN_UNEXPECTED(current_error(rc, _db)); \
+    }
+
+namespace sqlite
+{
+
+namespace
+{
+// Out-of-range sizes and offsets are clamped, sqlite3_blob_read() and sqlite3_blob_write() reject them.
+int clamp_to_int(size_t x)
+{
+    return int(std::min<size_t>(x, INT_MAX));
+}
+} // namespace
+
+blob_handle::blob_handle(sqlite3* db, sqlite3_blob* blob)
+    : _db(db)
+    , _blob(blob)
+{
+}
+
+blob_handle::blob_handle(blob_handle&& y)
+    : _db(y._db)
+    , _blob(y._blob)
+{
+    y._blob = nullptr;
+}
+
+blob_handle& blob_handle::operator=(blob_handle&& y)
+{
+    auto was_this = MOVE(*this);
+    std::swap(_db, y._db);
+    std::swap(_blob, y._blob);
+    return *this;
+}
+
+blob_handle::~blob_handle()
+{
+    if (_blob) {
+        sqlite3_blob_close(_blob);
+    }
+}
+
+size_t blob_handle::size() const
+{
+    return size_t(sqlite3_blob_bytes(_blob));
+}
+
+expected<void, current_error> blob_handle::read(span<byte> buffer, size_t offset)
+{
+    RETURN_UNEXPECTED_ON_ERROR(
+      sqlite3_blob_read(_blob, buffer.data(), clamp_to_int(buffer.size()), clamp_to_int(offset))
+    )
+    RETURN_VOID;
+}
+
+expected<size_t, current_error> blob_handle::read_some(span<byte> buffer, size_t offset)
+{
+    auto s = size();
+    auto n = offset < s ? std::min(buffer.size(), s - offset) : 0;
+    if (n == 0) {
+        return 0;
+    }
+    RETURN_UNEXPECTED_ON_ERROR(sqlite3_blob_read(_blob, buffer.data(), int(n), int(offset)))
+    return n;
+}
+
+expected<void, current_error> blob_handle::write(span<const byte> data, size_t offset)
+{
+    RETURN_UNEXPECTED_ON_ERROR(
+      sqlite3_blob_write(_blob, data.data(), clamp_to_int(data.size()), clamp_to_int(offset))
+    )
+    RETURN_VOID;
+}
+
+expected<void, current_error> blob_handle::reopen(int64_t rowid)
+{
+    RETURN_UNEXPECTED_ON_ERROR(sqlite3_blob_reopen(_blob, rowid))
+    RETURN_VOID;
+}
+
+expected<void, current_error> blob_handle::close()
+{
+    // The handle is closed even on error.
+    auto* blob = std::exchange(_blob, nullptr);
+    RETURN_UNEXPECTED_ON_ERROR(sqlite3_blob_close(blob))
+    RETURN_VOID;
+}
+
+expected<blob_handle, current_error> open_blob(
+  database& db, string_like_zt table, string_like_zt column, int64_t rowid, blob_mode mode, string_like_zt schema
+)
+{
+    sqlite3_blob* blob{};
+    if (int rc =
+          sqlite3_blob_open(db.handle(), schema.c_str(), table.c_str(), column.c_str(), rowid, int(mode), &blob)) {
+        // sqlite3_blob_open() sets `blob` to NULL on error.
+        RETURN_UNEXPECTED(current_error(rc, db.handle()));
+    }
+    return blob_handle(db.handle(), blob);
+}
+
+} // namespace sqlite
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+namespace sqlite
+{
+
+enum class blob_mode {
+    read_only = 0,
+    read_write = 1
+};
+
+// Incremental I/O on a single BLOB value, see sqlite3_blob_open().
+//
+// The reads and writes copy directly between the caller's buffer and the database pages, so large values can be
+// processed in bounded memory, chunk by chunk. The size of a BLOB can't be changed through the handle: to stream a
+// value into a new row, insert it with `statement::bind_zeroblob()` of the final size, then open the row with
+// `blob_mode::read_write` and write it in chunks, for example from a file descriptor or an mmap-ed region.
+//
+// The handle becomes expired when the row is modified by other means, the operations then fail with SQLITE_ABORT.
+class blob_handle
+{
+public:
+    blob_handle(sqlite3* db, sqlite3_blob* blob);
+
+    // `blob_handle` is move-only
+    blob_handle(const blob_handle&) = delete;
+    blob_handle(blob_handle&& y);
+    blob_handle& operator=(const blob_handle&) = delete;
+    blob_handle& operator=(blob_handle&& y);
+
+    // sqlite3_blob_close(), ignoring the errors.
+    ~blob_handle();
+
+    sqlite3_blob* handle() const
+    {
+        return _blob;
+    }
+
+    // sqlite3_blob_bytes().
+    size_t size() const;
+
+    // sqlite3_blob_read(), fill `buffer` starting at `offset`. It's an error to read past the end.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> read(span<byte> buffer, size_t offset);
+
+    // Read at most `buffer.size()` bytes from `offset`, return the number of bytes read, zero at the end.
+    [[nodiscard]] expected<size_t, current_error> read_some(span<byte> buffer, size_t offset);
+
+    // sqlite3_blob_write(), write `data` starting at `offset`. It's an error to write past the end.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> write(span<const byte> data, size_t offset);
+
+    // sqlite3_blob_reopen(), move the handle to the same column of another row of the same table.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> reopen(int64_t rowid);
+
+    // sqlite3_blob_close(), it can report the errors of committing the pending writes.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> close();
+
+private:
+    sqlite3* _db;
+    sqlite3_blob* _blob;
+};
+
+// sqlite3_blob_open().
+expected<blob_handle, current_error> open_blob(
+  database& db,
+  string_like_zt table,
+  string_like_zt column,
+  int64_t rowid,
+  blob_mode mode = blob_mode::read_only,
+  string_like_zt schema = "main"
+);
+
+} // namespace sqlite
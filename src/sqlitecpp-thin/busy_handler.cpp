@@ -0,0 +1,119 @@
+#include "busy_handler.hpp"
+
+#include "interrupt.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+namespace sqlite
+{
+
+busy_handler::busy_handler()
+    : _policy()
+    , _interrupt_scope(nullptr)
+    , _deadline()
+    , _wait(0)
+    , _random_state(
+        uint64_t(std::chrono::steady_clock::now().time_since_epoch().count()) ^ reinterpret_cast<uintptr_t>(this)
+      )
+    , _events(0)
+    , _retries(0)
+    , _timeouts(0)
+    , _total_wait_ns(0)
+    , _max_wait_ns(0)
+{
+}
+
+void busy_handler::set_policy(const busy_policy& policy)
+{
+    _policy = policy;
+}
+
+void busy_handler::set_interrupt_scope(interrupt_scope* scope)
+{
+    assert(!scope || !_interrupt_scope);
+    _interrupt_scope = scope;
+}
+
+busy_stats busy_handler::get_stats(bool reset)
+{
+    constexpr auto relaxed = std::memory_order_relaxed;
+    if (reset) {
+        return busy_stats{
+          .events = _events.exchange(0, relaxed),
+          .retries = _retries.exchange(0, relaxed),
+          .timeouts = _timeouts.exchange(0, relaxed),
+          .total_wait = std::chrono::nanoseconds(_total_wait_ns.exchange(0, relaxed)),
+          .max_wait = std::chrono::nanoseconds(_max_wait_ns.exchange(0, relaxed)),
+        };
+    }
+    return busy_stats{
+      .events = _events.load(relaxed),
+      .retries = _retries.load(relaxed),
+      .timeouts = _timeouts.load(relaxed),
+      .total_wait = std::chrono::nanoseconds(_total_wait_ns.load(relaxed)),
+      .max_wait = std::chrono::nanoseconds(_max_wait_ns.load(relaxed)),
+    };
+}
+
+int busy_handler::callback(void* p, int count)
+{
+    return static_cast<busy_handler*>(p)->wait(count) ? 1 : 0;
+}
+
+bool busy_handler::wait(int count)
+{
+    using clock = std::chrono::steady_clock;
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    auto now = clock::now();
+    if (count == 0) {
+        // SQLite restarts the count for each lock it waits for.
+        _events.fetch_add(1, relaxed);
+        _deadline = now + _policy.timeout;
+        _wait = std::chrono::nanoseconds(0);
+    }
+    if (_interrupt_scope && _interrupt_scope->check()) {
+        // Not a timeout of the policy, the statement fails with SQLITE_BUSY and the scope tells why.
+        return false;
+    }
+    if (now >= _deadline) {
+        _timeouts.fetch_add(1, relaxed);
+        return false;
+    }
+
+    // initial_delay * 2^count, without overflowing.
+    auto delay = std::chrono::duration<double, std::micro>(_policy.max_delay);
+    if (count < 32) {
+        delay = std::min(delay, std::chrono::duration<double, std::micro>(_policy.initial_delay) * double(1u << count));
+    }
+    delay *= 1.0 - std::clamp(_policy.jitter, 0.0, 1.0) * random();
+    auto sleep = std::min(std::chrono::duration_cast<clock::duration>(delay), _deadline - now);
+    if (_interrupt_scope && _interrupt_scope->_deadline) {
+        sleep = std::min(sleep, *_interrupt_scope->_deadline - now);
+    }
+    std::this_thread::sleep_for(sleep);
+
+    const auto slept = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - now);
+    _wait += slept;
+    _retries.fetch_add(1, relaxed);
+    _total_wait_ns.fetch_add(slept.count(), relaxed);
+    // Only the thread using the connection raises the maximum.
+    if (_wait.count() > _max_wait_ns.load(relaxed)) {
+        _max_wait_ns.store(_wait.count(), relaxed);
+    }
+    return true;
+}
+
+double busy_handler::random()
+{
+    // splitmix64
+    uint64_t z = (_random_state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    z ^= z >> 31;
+    return double(z >> 11) * 0x1.0p-53;
+}
+
+} // namespace sqlite
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <atomic>
+
+namespace sqlite
+{
+
+class interrupt_scope;
+
+// State of the sqlite3_busy_handler() installed by `database::set_busy_policy()`, owned by `database`. The handler runs
+// on the thread using the connection, the counters are relaxed atomics so they can be read from any thread.
+class busy_handler
+{
+public:
+    busy_handler();
+
+    busy_handler(const busy_handler&) = delete;
+    busy_handler& operator=(const busy_handler&) = delete;
+
+    void set_policy(const busy_policy& policy);
+
+    busy_stats get_stats(bool reset);
+
+    // The `interrupt_scope` of the database, or null. Its deadline and stop token also end the lock waits: the handler
+    // gives up once they are reached and never sleeps past the deadline. There is at most one scope at a time.
+    void set_interrupt_scope(interrupt_scope* scope);
+
+    // The callback of sqlite3_busy_handler(), `p` is the `busy_handler`.
+    static int callback(void* p, int count);
+
+private:
+    // Return true after sleeping, false to give up.
+    bool wait(int count);
+
+    // Random number in [0, 1).
+    double random();
+
+    busy_policy _policy;
+    interrupt_scope* _interrupt_scope;
+
+    // The current lock wait.
+    std::chrono::steady_clock::time_point _deadline;
+    std::chrono::nanoseconds _wait;
+    uint64_t _random_state;
+
+    std::atomic<uint64_t> _events;
+    std::atomic<uint64_t> _retries;
+    std::atomic<uint64_t> _timeouts;
+    std::atomic<int64_t> _total_wait_ns;
+    std::atomic<int64_t> _max_wait_ns;
+};
+
+} // namespace sqlite
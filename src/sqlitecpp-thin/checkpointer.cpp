@@ -0,0 +1,212 @@
+#include "checkpointer.hpp"
+
+#include "common.hpp"
+
+#include <algorithm>
+
+namespace sqlite
+{
+
+namespace
+{
+// SQLITE_DEFAULT_WAL_AUTOCHECKPOINT of the SQLite sources, not defined in sqlite3.h.
+constexpr int k_default_wal_autocheckpoint = 1000;
+
+// Zero if disabled, or replaced by another WAL hook.
+int get_wal_autocheckpoint(sqlite3* db)
+{
+    sqlite3_stmt* stmt = nullptr;
+    int frames = k_default_wal_autocheckpoint;
+    if (sqlite3_prepare_v2(db, "PRAGMA wal_autocheckpoint", -1, &stmt, nullptr) == SQLITE_OK
+        && sqlite3_step(stmt) == SQLITE_ROW) {
+        frames = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return frames;
+}
+} // namespace
+
+checkpointer::checkpointer(database&& db, const checkpointer_options& options)
+    : _db(MOVE(db))
+    , _options(options)
+    , _writers_mutex()
+    , _writers()
+    , _requested(false)
+    , _wakeup(0)
+    , _stop(false)
+    , _wal_frames(0)
+    , _wal_resets(0)
+    , _wal_opened(false)
+    , _last_checkpointed_frames(0)
+    , _last_wal_resets(0)
+    , _stats_mutex()
+    , _stats()
+    , _thread()
+{
+    _thread = std::thread([this] {
+        run();
+    });
+}
+
+checkpointer::~checkpointer()
+{
+    {
+        std::lock_guard lock(_writers_mutex);
+        for (const auto& writer : _writers) {
+            sqlite3_wal_autocheckpoint(writer.handle, writer.autocheckpoint);
+        }
+        _writers.clear();
+    }
+    _stop.store(true);
+    // Already pending if `_requested` is set.
+    request_checkpoint();
+    _thread.join();
+}
+
+void checkpointer::attach(database& writer)
+{
+    std::lock_guard lock(_writers_mutex);
+    const auto attached = std::find_if(_writers.begin(), _writers.end(), [&](const attached_writer& w) {
+        return w.handle == writer.handle();
+    });
+    if (attached != _writers.end()) {
+        // The autocheckpoint read now would be the 0 of our hook.
+        return;
+    }
+    const int autocheckpoint = get_wal_autocheckpoint(writer.handle());
+    // sqlite3_wal_autocheckpoint() is a WAL hook too, which is replaced.
+    sqlite3_wal_hook(writer.handle(), &checkpointer::wal_hook, this);
+    _writers.push_back(attached_writer{.handle = writer.handle(), .autocheckpoint = autocheckpoint});
+}
+
+void checkpointer::detach(database& writer)
+{
+    std::lock_guard lock(_writers_mutex);
+    auto it = std::find_if(_writers.begin(), _writers.end(), [&](const attached_writer& w) {
+        return w.handle == writer.handle();
+    });
+    if (it != _writers.end()) {
+        sqlite3_wal_autocheckpoint(it->handle, it->autocheckpoint);
+        _writers.erase(it);
+    }
+}
+
+void checkpointer::request_checkpoint()
+{
+    if (!_requested.exchange(true)) {
+        _wakeup.release();
+    }
+}
+
+checkpointer_stats checkpointer::get_stats() const
+{
+    std::lock_guard lock(_stats_mutex);
+    return _stats;
+}
+
+int checkpointer::wal_hook(void* p, sqlite3*, const char*, int frames)
+{
+    auto* c = static_cast<checkpointer*>(p);
+    if (c->_wal_frames.exchange(frames, std::memory_order_relaxed) > frames) {
+        c->_wal_resets.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (frames >= c->_options.checkpoint_frames) {
+        c->request_checkpoint();
+    }
+    return SQLITE_OK;
+}
+
+void checkpointer::run()
+{
+    for (;;) {
+        if (_options.interval.count() == 0) {
+            _wakeup.acquire();
+            _requested.store(false);
+        } else if (_wakeup.try_acquire_for(_options.interval)) {
+            _requested.store(false);
+        }
+        // After a timeout, a set `_requested` means that the semaphore is or is about to be released, and the next
+        // wait returns immediately.
+        if (_stop.load()) {
+            return;
+        }
+        checkpoint();
+    }
+}
+
+void checkpointer::checkpoint()
+{
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    checkpointer_stats delta;
+    optional<error> last_error;
+    int wal_frames = 0;
+
+    // Return false on error.
+    auto checkpoint_with_mode = [&](int mode) {
+        ++delta.checkpoints;
+        const uint64_t wal_resets = _wal_resets.load(std::memory_order_relaxed);
+#if SQLITECPPTHIN_EXPECTED
+        auto r = _db.wal_checkpoint_v2(mode);
+        if (!r) {
+            ++delta.errors;
+            last_error = r.error().get_error();
+            return false;
+        }
+        const auto& result = *r;
+#else
+        wal_checkpoint_result result;
+        try {
+            result = _db.wal_checkpoint_v2(mode);
+        } catch (const exception& e) {
+            ++delta.errors;
+            last_error = e.get_error();
+            return false;
+        }
+#endif
+        if (result.busy) {
+            ++delta.busy;
+        }
+        // The count restarts from zero when the WAL is reused from its start.
+        const int checkpointed = std::max(result.checkpointed_frames, 0);
+        const int previous = wal_resets == _last_wal_resets ? _last_checkpointed_frames : 0;
+        delta.frames_checkpointed += uint64_t(std::max(checkpointed - previous, 0));
+        _last_checkpointed_frames = checkpointed;
+        _last_wal_resets = wal_resets;
+        wal_frames = result.log_frames;
+        return true;
+    };
+
+    if (!_wal_opened) {
+        // The connection finds out that the database is in WAL mode when reading it, until then the checkpoints do
+        // nothing. A failure shows up in the checkpoint.
+        sqlite3_exec(_db.handle(), "SELECT 1 FROM main.sqlite_schema LIMIT 1", nullptr, nullptr, nullptr);
+    }
+    if (checkpoint_with_mode(SQLITE_CHECKPOINT_PASSIVE)) {
+        _wal_opened = wal_frames >= 0;
+        if (_options.truncate_frames > 0 && wal_frames >= _options.truncate_frames) {
+            ++delta.truncates;
+            checkpoint_with_mode(SQLITE_CHECKPOINT_TRUNCATE);
+        } else if (_options.restart_frames > 0 && wal_frames >= _options.restart_frames) {
+            ++delta.restarts;
+            checkpoint_with_mode(SQLITE_CHECKPOINT_RESTART);
+        }
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0);
+    std::lock_guard lock(_stats_mutex);
+    _stats.checkpoints += delta.checkpoints;
+    _stats.restarts += delta.restarts;
+    _stats.truncates += delta.truncates;
+    _stats.busy += delta.busy;
+    _stats.errors += delta.errors;
+    _stats.frames_checkpointed += delta.frames_checkpointed;
+    _stats.wal_frames = wal_frames;
+    _stats.total_time += elapsed;
+    _stats.max_time = std::max(_stats.max_time, elapsed);
+    if (last_error) {
+        _stats.last_error = MOVE(last_error);
+    }
+}
+
+} // namespace sqlite
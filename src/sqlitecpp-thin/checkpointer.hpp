@@ -0,0 +1,126 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+namespace sqlite
+{
+
+struct checkpointer_options {
+    // A commit leaving at least this many frames in the WAL wakes up the checkpointer, like PRAGMA wal_autocheckpoint.
+    int checkpoint_frames = 1000;
+    // Escalate to SQLITE_CHECKPOINT_RESTART when the WAL has at least this many frames after the PASSIVE checkpoint,
+    // i.e. readers kept it from being reused from the start. RESTART waits for the readers (through the busy handler of
+    // the checkpointer connection) and blocks new writers meanwhile. Zero disables.
+    int restart_frames = 10000;
+    // Like `restart_frames` for SQLITE_CHECKPOINT_TRUNCATE, which also truncates the WAL file to zero bytes. Zero
+    // disables.
+    int truncate_frames = 100000;
+    // Also checkpoint at this interval, without commits. Zero disables.
+    std::chrono::milliseconds interval = std::chrono::milliseconds(0);
+};
+
+struct checkpointer_stats {
+    // sqlite3_wal_checkpoint_v2() calls, and those in RESTART or TRUNCATE mode.
+    uint64_t checkpoints = 0;
+    uint64_t restarts = 0;
+    uint64_t truncates = 0;
+    // Checkpoints which couldn't complete (SQLITE_BUSY), or failed.
+    uint64_t busy = 0;
+    uint64_t errors = 0;
+    // Frames copied from the WAL into the database. Exact as long as all writers are attached, since the count of
+    // SQLite restarts when the WAL is reused from its start.
+    uint64_t frames_checkpointed = 0;
+    // Size of the WAL after the last checkpoint, in frames.
+    int wal_frames = 0;
+    // Time spent checkpointing, in total and by the longest checkpoint.
+    std::chrono::nanoseconds total_time = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds max_time = std::chrono::nanoseconds(0);
+    // Error of the last failed checkpoint.
+    optional<error> last_error = {};
+};
+
+// Background checkpoints of a database in WAL mode.
+//
+// Without it, the connection committing the transaction which fills the WAL past the wal_autocheckpoint threshold
+// runs the checkpoint, inside its commit. The checkpointer instead runs the checkpoints on its own connection and
+// thread, woken up by sqlite3_wal_hook() of the writer connections, whose autocheckpoint is disabled:
+//
+//     sqlite::checkpointer c(sqlite::open(path, sqlite::open_options::oltp_wal()).value());
+//     c.attach(writer_db);
+//
+// The checkpoints are PASSIVE, escalating to RESTART and TRUNCATE when the WAL keeps growing, see
+// `checkpointer_options`.
+class checkpointer
+{
+public:
+    // `db` is a connection to the database, used only for the checkpoints.
+    explicit checkpointer(database&& db, const checkpointer_options& options = {});
+
+    checkpointer(const checkpointer&) = delete;
+    checkpointer& operator=(const checkpointer&) = delete;
+
+    // Detach the writers, restoring their autocheckpoint, and stop the thread.
+    ~checkpointer();
+
+    // Disable the autocheckpoint of `writer` and install the WAL hook, which wakes up the checkpointer. The writer
+    // must be detached before it's closed, or outlive the checkpointer. Does nothing if `writer` is already attached.
+    void attach(database& writer);
+
+    // Remove the WAL hook and restore the autocheckpoint `writer` had when attached.
+    void detach(database& writer);
+
+    // Wake up the checkpointer, without waiting for the checkpoint.
+    void request_checkpoint();
+
+    checkpointer_stats get_stats() const;
+
+private:
+    // The callback of sqlite3_wal_hook().
+    static int wal_hook(void* p, sqlite3* db, const char* schema, int frames);
+
+    void run();
+    void checkpoint();
+
+    database _db;
+    checkpointer_options _options;
+
+    struct attached_writer {
+        sqlite3* handle;
+        // PRAGMA wal_autocheckpoint before `attach()`, restored by `detach()`.
+        int autocheckpoint;
+    };
+
+    std::mutex _writers_mutex;
+    std::vector<attached_writer> _writers;
+
+    // `_wakeup` is released only by the thread setting `_requested`, which is cleared only after acquiring it, so it's
+    // never released twice (undefined behavior for a binary_semaphore).
+    std::atomic<bool> _requested;
+    std::binary_semaphore _wakeup;
+    std::atomic<bool> _stop;
+
+    // Size of the WAL at the last commit, and number of times a commit found it smaller: the writers reused the WAL
+    // from its start.
+    std::atomic<int> _wal_frames;
+    std::atomic<uint64_t> _wal_resets;
+
+    // Whether a checkpoint found the database in WAL mode.
+    bool _wal_opened;
+    // Frames backfilled after the previous checkpoint and `_wal_resets` before it, to count the new frames.
+    int _last_checkpointed_frames;
+    uint64_t _last_wal_resets;
+
+    mutable std::mutex _stats_mutex;
+    checkpointer_stats _stats;
+
+    std::thread _thread;
+};
+
+} // namespace sqlite
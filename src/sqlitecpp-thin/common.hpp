@@ -11,14 +11,50 @@ namespace sqlite
 
 using std::nullopt;
 
+// `RETURN_IF_UNEXPECTED(f())` returns the error of `f()`, whose value is discarded. With exceptions `f()` throws it.
 #if SQLITECPPTHIN_EXPECTED
   #define RETURN_UNEXPECTED(X) return std::unexpected(X)
   #define RETURN_VOID \
       return {}
+  #define RETURN_IF_UNEXPECTED(X)                                         \
+      do {                                                                \
+          if (auto sqlitecppthin_result = (X); !sqlitecppthin_result) {   \
+              return std::unexpected(MOVE(sqlitecppthin_result.error())); \
+          }                                                               \
+      } while (false)
 #elif SQLITECPPTHIN_EXCEPTION
   #define RETURN_UNEXPECTED(X) throw(sqlite::exception(X))
   #define RETURN_VOID return
+  #define RETURN_IF_UNEXPECTED(X) X
 #else
   #error Either SQLITECPPTHIN_EXCEPTION or SQLITECPPTHIN_EXPECTED must be defined to 1.
 #endif
+
+// For the functions which return a result code without setting it on a database handle.
+inline error create_error_for_rc(int rc)
+{
+    return error{.errcode = rc, .extended_errcode = rc, .errmsg = sqlite3_errstr(rc), .error_offset = -1};
+}
+
+// For the functions which set the result code on the database handle only in some cases: use the fields of the database
+// if they belong to `rc`.
+inline error create_error_for_rc(int rc, sqlite3* db)
+{
+    if (sqlite3_errcode(db) == rc) {
+        return current_error(rc, db).get_error();
+    }
+    return create_error_for_rc(rc);
+}
+
+// The pointer bound by `statement::bind_array()`, read by the table-valued function of `register_carray()`.
+struct array_binding {
+    const void* data;
+    size_t size;
+    // SQLITE_INTEGER: int64_t, SQLITE_FLOAT: double, SQLITE_TEXT: string_view.
+    int type;
+};
+
+// Type of the pointer for sqlite3_bind_pointer() and sqlite3_value_pointer().
+inline constexpr char k_array_pointer_type[] = "sqlitecpp-thin-array";
+
 } // namespace sqlite
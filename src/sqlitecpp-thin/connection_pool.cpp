@@ -0,0 +1,177 @@
+#include "connection_pool.hpp"
+
+#include "common.hpp"
+
+#include <atomic>
+#include <cassert>
+
+namespace sqlite
+{
+
+namespace
+{
+// The slot index this thread has used most recently, in any pool. It's only a hint.
+thread_local size_t t_preferred_index = 0;
+
+// One cache line per slot, to avoid false sharing between threads checking out neighboring connections.
+struct alignas(64) slot {
+    explicit slot(database&& db_arg)
+        : db(MOVE(db_arg))
+        , in_use(false)
+    {
+    }
+
+    database db;
+    std::atomic<bool> in_use;
+};
+} // namespace
+
+struct connection_pool::impl {
+    impl()
+        : slots()
+        , num_waiters(0)
+        , num_releases(0)
+    {
+    }
+
+    std::vector<std::unique_ptr<slot>> slots;
+
+    // Used only when the pool is exhausted: waiters block on `num_releases` with `std::atomic::wait()`.
+    std::atomic<size_t> num_waiters;
+    std::atomic<uint32_t> num_releases;
+};
+
+expected<connection_pool, error> open_connection_pool(const fs::path& filename, const connection_pool_options& options)
+{
+    if (options.size == 0) {
+        // `acquire()` would wait forever.
+        RETURN_UNEXPECTED(create_error_for_rc(SQLITE_MISUSE));
+    }
+    auto impl = std::make_unique<connection_pool::impl>();
+    impl->slots.reserve(options.size);
+    for (size_t i = 0; i < options.size; ++i) {
+        auto db = open(filename, options.open);
+#if SQLITECPPTHIN_EXPECTED
+        if (!db) {
+            RETURN_UNEXPECTED(MOVE(db.error()));
+        }
+        db->set_statement_cache_capacity(options.statement_cache_capacity);
+        impl->slots.push_back(std::make_unique<slot>(MOVE(*db)));
+#else
+        db.set_statement_cache_capacity(options.statement_cache_capacity);
+        impl->slots.push_back(std::make_unique<slot>(MOVE(db)));
+#endif
+    }
+    return connection_pool(MOVE(impl));
+}
+
+connection_pool::connection_pool(std::unique_ptr<impl> impl_arg)
+    : _impl(MOVE(impl_arg))
+{
+}
+
+connection_pool::connection_pool(connection_pool&& y) = default;
+connection_pool& connection_pool::operator=(connection_pool&& y) = default;
+connection_pool::~connection_pool() = default;
+
+size_t connection_pool::size() const
+{
+    return _impl->slots.size();
+}
+
+optional<size_t> connection_pool::try_acquire_index()
+{
+    auto& slots = _impl->slots;
+    const size_t n = slots.size();
+    for (size_t i = 0; i < n; ++i) {
+        size_t index = (t_preferred_index + i) % n;
+        auto& in_use = slots[index]->in_use;
+        bool expected_in_use = false;
+        if (!in_use.load(std::memory_order_relaxed) && in_use.compare_exchange_strong(expected_in_use, true)) {
+            t_preferred_index = index;
+            return index;
+        }
+    }
+    return nullopt;
+}
+
+optional<pooled_connection> connection_pool::try_acquire()
+{
+    if (auto index = try_acquire_index()) {
+        return pooled_connection(this, *index);
+    }
+    return nullopt;
+}
+
+pooled_connection connection_pool::acquire()
+{
+    if (auto index = try_acquire_index()) {
+        return pooled_connection(this, *index);
+    }
+    ++_impl->num_waiters;
+    for (;;) {
+        auto num_releases = _impl->num_releases.load();
+        if (auto index = try_acquire_index()) {
+            --_impl->num_waiters;
+            return pooled_connection(this, *index);
+        }
+        _impl->num_releases.wait(num_releases);
+    }
+}
+
+void connection_pool::release(size_t index)
+{
+    assert(_impl->slots[index]->in_use);
+    _impl->slots[index]->in_use.store(false);
+    // A waiter increments `num_waiters` and reads `num_releases` before its last attempt to acquire, so it either
+    // sees the slot released or doesn't block on the changed `num_releases`.
+    if (_impl->num_waiters.load() > 0) {
+        ++_impl->num_releases;
+        _impl->num_releases.notify_one();
+    }
+}
+
+database& connection_pool::get(size_t index) const
+{
+    return _impl->slots[index]->db;
+}
+
+pooled_connection::pooled_connection(connection_pool* pool, size_t index)
+    : _pool(pool)
+    , _index(index)
+{
+}
+
+pooled_connection::pooled_connection(pooled_connection&& y)
+    : _pool(y._pool)
+    , _index(y._index)
+{
+    y._pool = nullptr;
+}
+
+pooled_connection& pooled_connection::operator=(pooled_connection&& y)
+{
+    auto was_this = MOVE(*this);
+    std::swap(_pool, y._pool);
+    std::swap(_index, y._index);
+    return *this;
+}
+
+pooled_connection::~pooled_connection()
+{
+    if (_pool) {
+        _pool->release(_index);
+    }
+}
+
+database& pooled_connection::operator*() const
+{
+    return _pool->get(_index);
+}
+
+database* pooled_connection::operator->() const
+{
+    return &_pool->get(_index);
+}
+
+} // namespace sqlite
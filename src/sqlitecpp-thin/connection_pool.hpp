@@ -0,0 +1,91 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <memory>
+
+namespace sqlite
+{
+
+struct connection_pool_options {
+    // Number of connections.
+    size_t size = 4;
+    // Options of each connection, see also `open_options::read_only_mmap()`.
+    open_options open = {.flags = SQLITE_OPEN_READONLY};
+    // See `database::set_statement_cache_capacity()`.
+    size_t statement_cache_capacity = database::k_default_statement_cache_capacity;
+};
+
+class connection_pool;
+
+// A connection checked out of a `connection_pool`, it's checked back in on destruction. The lease must not outlive
+// the pool.
+class pooled_connection
+{
+public:
+    // `pooled_connection` is move-only
+    pooled_connection(const pooled_connection&) = delete;
+    pooled_connection(pooled_connection&& y);
+    pooled_connection& operator=(const pooled_connection&) = delete;
+    pooled_connection& operator=(pooled_connection&& y);
+
+    ~pooled_connection();
+
+    database& operator*() const;
+    database* operator->() const;
+
+private:
+    friend class connection_pool;
+
+    pooled_connection(connection_pool* pool, size_t index);
+
+    connection_pool* _pool = nullptr;
+    size_t _index = 0;
+};
+
+// Fixed number of connections to the same database file, opened with the same flags and initialized with the same SQL,
+// typically for concurrent readers of a database in WAL mode. The pool is thread-safe, the connections (and their
+// statement caches) are used by one thread at a time.
+//
+// Checking out a connection is lock-free unless the pool is exhausted. Each thread first tries the connection it used
+// most recently, so the statement caches stay warm.
+class connection_pool
+{
+public:
+    // `connection_pool` is move-only
+    connection_pool(const connection_pool&) = delete;
+    connection_pool(connection_pool&& y);
+    connection_pool& operator=(const connection_pool&) = delete;
+    connection_pool& operator=(connection_pool&& y);
+
+    ~connection_pool();
+
+    // Check out a connection, block until one is available.
+    pooled_connection acquire();
+
+    // Check out a connection or return `std::nullopt` if all of them are in use.
+    optional<pooled_connection> try_acquire();
+
+    size_t size() const;
+
+private:
+    friend expected<connection_pool, error>
+    open_connection_pool(const fs::path& filename, const connection_pool_options& options);
+    friend class pooled_connection;
+
+    struct impl;
+
+    explicit connection_pool(std::unique_ptr<impl> impl_arg);
+
+    optional<size_t> try_acquire_index();
+    void release(size_t index);
+    database& get(size_t index) const;
+
+    std::unique_ptr<impl> _impl;
+};
+
+// Open `options.size` connections to `filename`. On failure all connections are closed. Fails with SQLITE_MISUSE if
+// `options.size` is zero.
+expected<connection_pool, error> open_connection_pool(const fs::path& filename, const connection_pool_options& options);
+
+} // namespace sqlite
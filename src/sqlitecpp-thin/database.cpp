@@ -1,6 +1,11 @@
 #include "sqlite3.hpp"
 
+#include "busy_handler.hpp"
 #include "common.hpp"
+#include "metrics.hpp"
+#include "statement_cache.hpp"
+
+#include <chrono>
 
 #define RETURN_UNEXPECTED_ON_ERROR(X)              \
     if (int rc = (X)) {                            \
@@ -12,31 +17,48 @@ namespace sqlite
 
 database::database(sqlite3* db)
     : _db(db)
+    , _statement_cache()
+    , _metrics()
+    , _busy_handler()
 {
 }
 
 database::database(database&& y)
     : _db(y._db)
+    , _statement_cache(MOVE(y._statement_cache))
+    , _metrics(y._metrics)
+    , _busy_handler(MOVE(y._busy_handler))
 {
     y._db = nullptr;
+    y._metrics = nullptr;
 }
 
 database& database::operator=(database&& y)
 {
     auto was_this = MOVE(*this);
     std::swap(_db, y._db);
+    std::swap(_statement_cache, y._statement_cache);
+    std::swap(_metrics, y._metrics);
+    std::swap(_busy_handler, y._busy_handler);
     return *this;
 }
 
 database::~database()
 {
+    // Finalize the cached statements first.
+    _statement_cache.reset();
     if (_db) {
+        // The handler is destroyed with `this`, while statements left unfinalized keep the connection open.
+        if (_busy_handler) {
+            sqlite3_busy_handler(_db, nullptr, nullptr);
+        }
         sqlite3_close_v2(_db);
     }
 }
 
 expected<void, current_error> database::close()
 {
+    clear_statement_cache();
     RETURN_UNEXPECTED_ON_ERROR(sqlite3_close(_db))
     _db = nullptr;
     RETURN_VOID;
@@ -91,8 +113,23 @@ int database::error_offset() const
     return sqlite3_error_offset(_db);
 }
 
+namespace
+{
+using clock = std::chrono::steady_clock;
+
+// Record the prepare time and return the metrics to install in the statement.
+statement_metrics* record_prepare(metrics* m, sqlite3_stmt* stmt, clock::time_point start)
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+    auto* sm = m->get_statement_metrics(sqlite3_sql(stmt));
+    sm->record_prepare(uint64_t(ns));
+    return sm;
+}
+} // namespace
+
 expected<statement, current_error> database::prepare(string_like sql)
 {
+    auto start = _metrics ? clock::now() : clock::time_point();
     sqlite3_stmt* stmt{};
     RETURN_UNEXPECTED_ON_ERROR(sqlite3_prepare_v2(
       _db,
@@ -101,7 +138,201 @@ expected<statement, current_error> database::prepare(string_like sql)
       &stmt,
       nullptr
     ))
-    return statement(stmt);
+    return statement(stmt, _metrics ? record_prepare(_metrics, stmt, start) : nullptr);
+}
+
+expected<statement, current_error> database::prepare(string_like sql, unsigned int prep_flags)
+{
+    auto start = _metrics ? clock::now() : clock::time_point();
+    sqlite3_stmt* stmt{};
+    RETURN_UNEXPECTED_ON_ERROR(sqlite3_prepare_v3(
+      _db,
+      sql.c_str(),
+      sql.size() ? int(*sql.size()) : -1, // Note: zero terminator doesn't need to be included in the size.
+      prep_flags,
+      &stmt,
+      nullptr
+    ))
+    return statement(stmt, _metrics ? record_prepare(_metrics, stmt, start) : nullptr);
+}
+
+expected<cached_statement, current_error> database::prepare_cached(string_like sql)
+{
+    if (!_statement_cache) {
+        _statement_cache = std::make_unique<statement_cache>(k_default_statement_cache_capacity);
+    }
+
+    // The cache key must not depend on whether the string literal's zero terminator was included in the size.
+    string_view key = sql.size() ? string_view(sql.c_str(), *sql.size()) : string_view(sql.c_str());
+    if (!key.empty() && key.back() == '\0') {
+        key.remove_suffix(1);
+    }
+
+    if (auto* entry = _statement_cache->lease(key)) {
+        return cached_statement(entry);
+    }
+
+    auto start = _metrics ? clock::now() : clock::time_point();
+    sqlite3_stmt* handle{};
+    RETURN_UNEXPECTED_ON_ERROR(
+      sqlite3_prepare_v3(_db, key.data(), int(key.size()), SQLITE_PREPARE_PERSISTENT, &handle, nullptr)
+    )
+    statement stmt(handle, _metrics ? record_prepare(_metrics, handle, start) : nullptr);
+    if (auto* entry = _statement_cache->insert(key, stmt)) {
+        return cached_statement(entry);
+    }
+    return cached_statement(MOVE(stmt));
+}
+
+void database::set_statement_cache_capacity(size_t capacity)
+{
+    if (_statement_cache) {
+        _statement_cache->set_capacity(capacity);
+    } else {
+        _statement_cache = std::make_unique<statement_cache>(capacity);
+    }
+}
+
+statement_cache_stats database::get_statement_cache_stats() const
+{
+    return _statement_cache ? _statement_cache->stats()
+                            : statement_cache_stats{.capacity = k_default_statement_cache_capacity};
+}
+
+void database::clear_statement_cache()
+{
+    if (_statement_cache) {
+        _statement_cache->clear();
+    }
+}
+
+void database::set_metrics(metrics* m)
+{
+    _metrics = m;
+}
+
+expected<void, error> database::create_function_raw(
+  string_like_zt name,
+  int num_args,
+  int flags,
+  void* user_data,
+  void (*func)(sqlite3_context*, int, sqlite3_value**),
+  void (*destroy)(void*)
+)
+{
+    // On failure sqlite3_create_function_v2() calls `destroy` and it sets the error on the database only for some of
+    // the result codes.
+    if (int rc = sqlite3_create_function_v2(
+          _db, name.c_str(), num_args, flags | SQLITE_UTF8, user_data, func, nullptr, nullptr, destroy
+        )) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc, _db));
+    }
+    RETURN_VOID;
+}
+
+expected<void, error> database::create_window_function_raw(
+  string_like_zt name,
+  int num_args,
+  int flags,
+  void* user_data,
+  void (*step)(sqlite3_context*, int, sqlite3_value**),
+  void (*final)(sqlite3_context*),
+  void (*value)(sqlite3_context*),
+  void (*inverse)(sqlite3_context*, int, sqlite3_value**),
+  void (*destroy)(void*)
+)
+{
+    if (int rc = sqlite3_create_window_function(
+          _db, name.c_str(), num_args, flags | SQLITE_UTF8, user_data, step, final, value, inverse, destroy
+        )) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc, _db));
+    }
+    RETURN_VOID;
+}
+
+expected<void, error> database::db_config_lookaside(int slot_size, int slot_count)
+{
+    // sqlite3_db_config() doesn't set the error on the database.
+    if (int rc = sqlite3_db_config(_db, SQLITE_DBCONFIG_LOOKASIDE, nullptr, slot_size, slot_count)) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    RETURN_VOID;
+}
+
+expected<void, error> database::db_config_lookaside(span<byte> buffer, int slot_size)
+{
+    auto slot_count = slot_size > 0 ? int(buffer.size() / size_t(slot_size)) : 0;
+    if (int rc = sqlite3_db_config(_db, SQLITE_DBCONFIG_LOOKASIDE, buffer.data(), slot_size, slot_count)) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc));
+    }
+    RETURN_VOID;
+}
+
+database_status database::status(bool reset) const
+{
+    int r = reset ? 1 : 0;
+    database_status s;
+    int unused{};
+    // sqlite3_db_status() fails only for unknown options.
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_LOOKASIDE_USED, &s.lookaside_used, &s.lookaside_used_highwater, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_LOOKASIDE_HIT, &unused, &s.lookaside_hit, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, &unused, &s.lookaside_miss_size, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, &unused, &s.lookaside_miss_full, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_CACHE_USED, &s.cache_used, &unused, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_CACHE_USED_SHARED, &s.cache_used_shared, &unused, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_SCHEMA_USED, &s.schema_used, &unused, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_STMT_USED, &s.stmt_used, &unused, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_CACHE_HIT, &s.cache_hit, &unused, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_CACHE_MISS, &s.cache_miss, &unused, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_CACHE_WRITE, &s.cache_write, &unused, r);
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_CACHE_SPILL, &s.cache_spill, &unused, r);
+    int deferred_fks{};
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_DEFERRED_FKS, &deferred_fks, &unused, r);
+    s.deferred_fks = deferred_fks != 0;
+    return s;
+}
+
+expected<wal_checkpoint_result, current_error> database::wal_checkpoint_v2(int mode, string_like_zt schema)
+{
+    wal_checkpoint_result result;
+    int rc = sqlite3_wal_checkpoint_v2(_db, schema.c_str(), mode, &result.log_frames, &result.checkpointed_frames);
+    if (rc == SQLITE_BUSY) {
+        result.busy = true;
+    } else if (rc != SQLITE_OK) {
+        RETURN_UNEXPECTED(current_error(rc, _db));
+    }
+    return result;
+}
+
+void database::wal_autocheckpoint(int frames)
+{
+    // Always returns SQLITE_OK.
+    sqlite3_wal_autocheckpoint(_db, frames);
+}
+
+void database::set_busy_policy(const optional<busy_policy>& policy)
+{
+    if (!policy) {
+        // Keep the handler for its counters.
+        sqlite3_busy_handler(_db, nullptr, nullptr);
+        return;
+    }
+    get_busy_handler().set_policy(*policy);
+    // Fails only with SQLITE_MISUSE.
+    sqlite3_busy_handler(_db, &busy_handler::callback, _busy_handler.get());
+}
+
+busy_handler& database::get_busy_handler()
+{
+    if (!_busy_handler) {
+        _busy_handler = std::make_unique<busy_handler>();
+    }
+    return *_busy_handler;
+}
+
+busy_stats database::get_busy_stats(bool reset) const
+{
+    return _busy_handler ? _busy_handler->get_stats(reset) : busy_stats{};
 }
 
 } // namespace sqlite
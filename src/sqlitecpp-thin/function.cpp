@@ -0,0 +1,48 @@
+#include "sqlite3.hpp"
+
+#include <algorithm>
+
+namespace sqlite
+{
+
+namespace
+{
+constexpr size_t k_chunk_size = 65536;
+} // namespace
+
+aggregate_state_arena::aggregate_state_arena(size_t block_size, size_t block_alignment)
+    : _block_alignment(std::max(block_alignment, alignof(free_block)))
+    , _block_size((std::max(block_size, sizeof(free_block)) + _block_alignment - 1) & ~(_block_alignment - 1))
+    , _blocks_per_chunk(std::max<size_t>(1, k_chunk_size / _block_size))
+    , _chunks()
+    , _free_list(nullptr)
+{
+}
+
+aggregate_state_arena::~aggregate_state_arena()
+{
+    for (auto* chunk : _chunks) {
+        ::operator delete(chunk, std::align_val_t(_block_alignment));
+    }
+}
+
+void* aggregate_state_arena::allocate()
+{
+    if (!_free_list) {
+        _chunks.reserve(_chunks.size() + 1);
+        auto* chunk =
+          static_cast<byte*>(::operator new(_block_size * _blocks_per_chunk, std::align_val_t(_block_alignment)));
+        _chunks.push_back(chunk);
+        for (size_t i = _blocks_per_chunk; i-- > 0;) {
+            _free_list = ::new (chunk + i * _block_size) free_block{_free_list};
+        }
+    }
+    return std::exchange(_free_list, _free_list->next);
+}
+
+void aggregate_state_arena::deallocate(void* p)
+{
+    _free_list = ::new (p) free_block{_free_list};
+}
+
+} // namespace sqlite
@@ -0,0 +1,71 @@
+#include "interrupt.hpp"
+
+#include "busy_handler.hpp"
+#include "common.hpp"
+
+#include <algorithm>
+
+namespace sqlite
+{
+
+interrupt_scope::interrupt_scope(database& db, const interrupt_options& options)
+    : _db(db.handle())
+    , _busy_handler(&db.get_busy_handler())
+    , _deadline(options.deadline)
+    , _stop_token(options.stop_token)
+    , _timed_out(false)
+    , _cancelled(false)
+    , _stop_callback()
+{
+    // Asserts that no other scope is active.
+    _busy_handler->set_interrupt_scope(this);
+    sqlite3_progress_handler(_db, std::max(options.progress_steps, 1), &interrupt_scope::progress, this);
+    if (_stop_token.stop_possible()) {
+        // Runs the callback right away if a stop was already requested.
+        _stop_callback.emplace(_stop_token, stop_callback_function{this});
+    }
+}
+
+interrupt_scope::interrupt_scope(database& db, std::chrono::steady_clock::duration timeout)
+    : interrupt_scope(db, interrupt_options{.deadline = std::chrono::steady_clock::now() + timeout})
+{
+}
+
+interrupt_scope::interrupt_scope(database& db, std::stop_token stop_token)
+    : interrupt_scope(db, interrupt_options{.stop_token = MOVE(stop_token)})
+{
+}
+
+interrupt_scope::~interrupt_scope()
+{
+    // Waits for a stop callback running on another thread.
+    _stop_callback.reset();
+    sqlite3_progress_handler(_db, 0, nullptr, nullptr);
+    _busy_handler->set_interrupt_scope(nullptr);
+}
+
+void interrupt_scope::stop_callback_function::operator()() const
+{
+    scope->_cancelled.store(true, std::memory_order_relaxed);
+    sqlite3_interrupt(scope->_db);
+}
+
+bool interrupt_scope::check()
+{
+    if (_deadline && std::chrono::steady_clock::now() >= *_deadline) {
+        _timed_out.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    if (_stop_token.stop_requested()) {
+        _cancelled.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+int interrupt_scope::progress(void* p)
+{
+    return static_cast<interrupt_scope*>(p)->check() ? 1 : 0;
+}
+
+} // namespace sqlite
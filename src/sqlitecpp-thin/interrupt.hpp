@@ -0,0 +1,96 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stop_token>
+
+namespace sqlite
+{
+
+struct interrupt_options {
+    // The statements fail with SQLITE_INTERRUPT once the deadline has passed.
+    optional<std::chrono::steady_clock::time_point> deadline = {};
+    // The statements fail with SQLITE_INTERRUPT once a stop is requested.
+    std::stop_token stop_token = {};
+    // Virtual machine instructions between the checks of the deadline and the stop token, see
+    // sqlite3_progress_handler(). Lower is more precise, higher is cheaper.
+    int progress_steps = 1000;
+};
+
+// Deadline and cancellation of the statements run on a database during the scope:
+//
+//     sqlite::interrupt_scope scope(db, std::chrono::milliseconds(100));
+//     while (stmt.step().value() == sqlite::step_result::row) { ... }
+//
+// When the deadline passes or the stop token is triggered, the running statement fails with SQLITE_INTERRUPT and
+// `timed_out()` or `cancelled()` tell why. The deadline is checked by sqlite3_progress_handler() every
+// `progress_steps` VM instructions, a stop request also calls sqlite3_interrupt() right away from the requesting
+// thread, so statements are interrupted even between progress checks (e.g. while sorting).
+//
+// A statement waiting for a lock in the busy handler of `database::set_busy_policy()` stops waiting at the deadline or
+// on a stop request and fails with SQLITE_BUSY, `timed_out()` or `cancelled()` tell why. The handler of
+// sqlite3_busy_timeout() isn't stopped.
+//
+// The progress handler of the database is replaced during the scope and removed afterwards, so the scopes of a database
+// can't be nested (asserted in debug builds).
+class interrupt_scope
+{
+public:
+    interrupt_scope(database& db, const interrupt_options& options);
+
+    // Interrupt the statements running after `timeout`.
+    interrupt_scope(database& db, std::chrono::steady_clock::duration timeout);
+
+    // Interrupt the statements when a stop is requested.
+    interrupt_scope(database& db, std::stop_token stop_token);
+
+    // Not movable: the progress handler and the stop callback point to the scope.
+    interrupt_scope(const interrupt_scope&) = delete;
+    interrupt_scope& operator=(const interrupt_scope&) = delete;
+
+    // Remove the progress handler.
+    ~interrupt_scope();
+
+    // The deadline has passed and a statement was interrupted.
+    bool timed_out() const
+    {
+        return _timed_out.load(std::memory_order_relaxed);
+    }
+
+    // A stop was requested.
+    bool cancelled() const
+    {
+        return _cancelled.load(std::memory_order_relaxed);
+    }
+
+    bool interrupted() const
+    {
+        return timed_out() || cancelled();
+    }
+
+private:
+    friend class busy_handler;
+
+    struct stop_callback_function {
+        interrupt_scope* scope;
+        void operator()() const;
+    };
+
+    // True when the deadline has passed or a stop is requested, and records which.
+    bool check();
+
+    // The callback of sqlite3_progress_handler(), non-zero to interrupt.
+    static int progress(void* p);
+
+    sqlite3* _db;
+    busy_handler* _busy_handler;
+    optional<std::chrono::steady_clock::time_point> _deadline;
+    std::stop_token _stop_token;
+    std::atomic<bool> _timed_out;
+    std::atomic<bool> _cancelled;
+    optional<std::stop_callback<stop_callback_function>> _stop_callback;
+};
+
+} // namespace sqlite
@@ -0,0 +1,177 @@
+#include "metrics.hpp"
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <unordered_map>
+
+namespace sqlite
+{
+
+namespace
+{
+std::atomic<uint64_t> g_next_metrics_id = 1;
+
+struct thread_shard_ref {
+    uint64_t metrics_id;
+    void* shard;
+};
+
+// The shards of the calling thread, in all `metrics` instances.
+thread_local std::vector<thread_shard_ref> t_shards;
+} // namespace
+
+uint64_t latency_histogram::quantile_ns(double q) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = uint64_t(std::clamp(q, 0.0, 1.0) * double(count - 1)) + 1;
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < k_num_buckets; ++i) {
+        cumulative += buckets[i];
+        if (cumulative >= rank) {
+            return i == 0 ? 0 : uint64_t(1) << i;
+        }
+    }
+    return UINT64_MAX;
+}
+
+statement_metrics::histogram::histogram()
+    : buckets()
+    , count(0)
+    , sum_ns(0)
+{
+}
+
+void statement_metrics::histogram::record(uint64_t ns)
+{
+    auto bucket = std::min<size_t>(std::bit_width(ns), latency_histogram::k_num_buckets - 1);
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum_ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+void statement_metrics::histogram::add_to(latency_histogram& h) const
+{
+    for (size_t i = 0; i < latency_histogram::k_num_buckets; ++i) {
+        h.buckets[i] += buckets[i].load(std::memory_order_relaxed);
+    }
+    h.count += count.load(std::memory_order_relaxed);
+    h.sum_ns += sum_ns.load(std::memory_order_relaxed);
+}
+
+statement_metrics::statement_metrics()
+    : _prepare()
+    , _step()
+    , _rows(0)
+    , _changes(0)
+{
+}
+
+void statement_metrics::record_prepare(uint64_t ns)
+{
+    _prepare.record(ns);
+}
+
+void statement_metrics::record_step(uint64_t ns, int rc, int64_t changes)
+{
+    _step.record(ns);
+    if (rc == SQLITE_ROW) {
+        _rows.fetch_add(1, std::memory_order_relaxed);
+    }
+    // A step returning a row may make changes too, e.g. INSERT ... RETURNING.
+    if (changes > 0) {
+        _changes.fetch_add(uint64_t(changes), std::memory_order_relaxed);
+    }
+}
+
+void statement_metrics::add_to(statement_metrics_snapshot& s) const
+{
+    _prepare.add_to(s.prepare);
+    _step.add_to(s.step);
+    s.rows += _rows.load(std::memory_order_relaxed);
+    s.changes += _changes.load(std::memory_order_relaxed);
+}
+
+struct metrics::shard {
+    struct string_hash {
+        using is_transparent = void;
+        size_t operator()(string_view sv) const
+        {
+            return std::hash<string_view>{}(sv);
+        }
+    };
+
+    shard()
+        : mutex()
+        , statements()
+    {
+    }
+
+    // Locked by the owner thread when adding statements and by `snapshot()`, practically uncontended.
+    std::mutex mutex;
+    std::unordered_map<string, std::unique_ptr<statement_metrics>, string_hash, std::equal_to<>> statements;
+};
+
+metrics::metrics()
+    : _id(g_next_metrics_id++)
+    , _mutex()
+    , _shards()
+{
+}
+
+metrics::~metrics() = default;
+
+metrics::shard& metrics::get_thread_shard()
+{
+    for (auto& ref : t_shards) {
+        if (ref.metrics_id == _id) {
+            return *static_cast<shard*>(ref.shard);
+        }
+    }
+    std::lock_guard lock(_mutex);
+    auto* s = _shards.emplace_back(std::make_unique<shard>()).get();
+    t_shards.push_back(thread_shard_ref{.metrics_id = _id, .shard = s});
+    return *s;
+}
+
+statement_metrics* metrics::get_statement_metrics(string_view sql)
+{
+    auto& s = get_thread_shard();
+    std::lock_guard lock(s.mutex);
+    auto it = s.statements.find(sql);
+    if (it == s.statements.end()) {
+        it = s.statements.emplace(string(sql), std::make_unique<statement_metrics>()).first;
+    }
+    return it->second.get();
+}
+
+std::vector<statement_metrics_snapshot> metrics::snapshot() const
+{
+    std::map<string, statement_metrics_snapshot, std::less<>> aggregated;
+    {
+        std::lock_guard lock(_mutex);
+        for (auto& s : _shards) {
+            std::lock_guard shard_lock(s->mutex);
+            for (auto& [sql, sm] : s->statements) {
+                auto it = aggregated.find(sql);
+                if (it == aggregated.end()) {
+                    statement_metrics_snapshot snapshot{.sql = sql, .prepare = {}, .step = {}};
+                    it = aggregated.emplace(sql, MOVE(snapshot)).first;
+                }
+                sm->add_to(it->second);
+            }
+        }
+    }
+    std::vector<statement_metrics_snapshot> result;
+    result.reserve(aggregated.size());
+    for (auto& [_, s] : aggregated) {
+        result.push_back(MOVE(s));
+    }
+    return result;
+}
+
+} // namespace sqlite
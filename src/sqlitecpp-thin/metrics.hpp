@@ -0,0 +1,102 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sqlite
+{
+
+// Latency histogram with power-of-two buckets: bucket `i` counts the durations in [2^(i-1), 2^i) nanoseconds, bucket 0
+// counts the zero durations.
+struct latency_histogram {
+    static constexpr size_t k_num_buckets = 64;
+
+    std::array<uint64_t, k_num_buckets> buckets{};
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+
+    // Upper bound of the bucket containing the `q` quantile (0 <= q <= 1), in nanoseconds. Zero if empty.
+    uint64_t quantile_ns(double q) const;
+};
+
+struct statement_metrics_snapshot {
+    // sqlite3_sql() of the statement.
+    string sql;
+    latency_histogram prepare;
+    latency_histogram step;
+    // Number of SQLITE_ROW results.
+    uint64_t rows = 0;
+    // Rows inserted, updated or deleted by the executions run to completion, including by triggers: the growth of
+    // sqlite3_total_changes64() across the steps. Zero for DDL.
+    uint64_t changes = 0;
+};
+
+// Live counters of a statement (SQL text), updated with relaxed atomics.
+class statement_metrics
+{
+public:
+    statement_metrics();
+
+    void record_prepare(uint64_t ns);
+    void record_step(uint64_t ns, int rc, int64_t changes);
+
+    // Add the counters to `s`.
+    void add_to(statement_metrics_snapshot& s) const;
+
+private:
+    struct histogram {
+        histogram();
+
+        std::array<std::atomic<uint64_t>, latency_histogram::k_num_buckets> buckets;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum_ns;
+
+        void record(uint64_t ns);
+        void add_to(latency_histogram& h) const;
+    };
+
+    histogram _prepare;
+    histogram _step;
+    std::atomic<uint64_t> _rows;
+    std::atomic<uint64_t> _changes;
+};
+
+// Metrics sink for `database::set_metrics()`. Records the prepare and step latencies, rows and changes per SQL text.
+//
+// The counters are sharded by the thread preparing the statement: looking up the counters happens once per prepare,
+// the steps only update atomics. Without a sink installed, the only cost is a null pointer check per prepare and step.
+//
+// The `metrics` object must outlive the databases and statements using it.
+class metrics
+{
+public:
+    metrics();
+    ~metrics();
+
+    metrics(const metrics&) = delete;
+    metrics& operator=(const metrics&) = delete;
+
+    // Return the counters of `sql` in the calling thread's shard.
+    statement_metrics* get_statement_metrics(string_view sql);
+
+    // Aggregate the counters of all threads, one item per SQL text, ordered by SQL text.
+    std::vector<statement_metrics_snapshot> snapshot() const;
+
+private:
+    struct shard;
+
+    shard& get_thread_shard();
+
+    // Distinguishes the instances in the thread-local shard lookup.
+    const uint64_t _id;
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<shard>> _shards;
+};
+
+} // namespace sqlite
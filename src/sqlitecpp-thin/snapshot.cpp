@@ -0,0 +1,129 @@
+#include "snapshot.hpp"
+
+#include "common.hpp"
+
+namespace sqlite
+{
+
+namespace
+{
+#ifndef HAS_SQLITE_SNAPSHOT
+error create_snapshot_unsupported_error()
+{
+    return error{
+      .errcode = SQLITE_ERROR,
+      .extended_errcode = SQLITE_ERROR,
+      .errmsg = "SQLite was built without SQLITE_ENABLE_SNAPSHOT",
+      .error_offset = -1,
+    };
+}
+#endif
+} // namespace
+
+bool snapshots_supported()
+{
+#ifdef HAS_SQLITE_SNAPSHOT
+    return true;
+#else
+    return false;
+#endif
+}
+
+snapshot::snapshot(sqlite3_snapshot* s)
+    : _snapshot(s)
+{
+}
+
+snapshot::snapshot(snapshot&& y)
+    : _snapshot(std::exchange(y._snapshot, nullptr))
+{
+}
+
+snapshot& snapshot::operator=(snapshot&& y)
+{
+    auto was_this = MOVE(*this);
+    std::swap(_snapshot, y._snapshot);
+    return *this;
+}
+
+snapshot::~snapshot()
+{
+#ifdef HAS_SQLITE_SNAPSHOT
+    if (_snapshot) {
+        sqlite3_snapshot_free(_snapshot);
+    }
+#endif
+}
+
+int snapshot::compare([[maybe_unused]] const snapshot& y) const
+{
+#ifdef HAS_SQLITE_SNAPSHOT
+    return sqlite3_snapshot_cmp(_snapshot, y._snapshot);
+#else
+    return 0;
+#endif
+}
+
+expected<transaction, current_error> begin_read_transaction(database& db)
+{
+    auto tx = begin_transaction(db);
+    // Reading the schema starts the read transaction.
+    auto stmt = db.prepare_cached("SELECT 1 FROM main.sqlite_schema LIMIT 1");
+#if SQLITECPPTHIN_EXPECTED
+    if (!tx) {
+        RETURN_UNEXPECTED(tx.error());
+    }
+    if (!stmt) {
+        RETURN_UNEXPECTED(stmt.error());
+    }
+    RETURN_IF_UNEXPECTED((*stmt)->step());
+    return MOVE(*tx);
+#else
+    stmt->step();
+    return tx;
+#endif
+}
+
+expected<transaction, error>
+begin_read_transaction(database& db, [[maybe_unused]] const snapshot& s, [[maybe_unused]] string_like_zt schema)
+{
+#ifdef HAS_SQLITE_SNAPSHOT
+    if (!sqlite3_get_autocommit(db.handle())) {
+        RETURN_UNEXPECTED(create_error_for_rc(SQLITE_ERROR));
+    }
+    auto tx = begin_transaction(db);
+  #if SQLITECPPTHIN_EXPECTED
+    if (!tx) {
+        RETURN_UNEXPECTED(tx.error().get_error());
+    }
+  #endif
+    // The BEGIN is deferred: no read transaction yet, so the snapshot can be opened. The transaction is rolled back on
+    // error.
+    if (int rc = sqlite3_snapshot_open(db.handle(), schema.c_str(), s.handle())) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc, db.handle()));
+    }
+  #if SQLITECPPTHIN_EXPECTED
+    return MOVE(*tx);
+  #else
+    return tx;
+  #endif
+#else
+    (void)db;
+    RETURN_UNEXPECTED(create_snapshot_unsupported_error());
+#endif
+}
+
+expected<snapshot, error> get_snapshot([[maybe_unused]] database& db, [[maybe_unused]] string_like_zt schema)
+{
+#ifdef HAS_SQLITE_SNAPSHOT
+    sqlite3_snapshot* s = nullptr;
+    if (int rc = sqlite3_snapshot_get(db.handle(), schema.c_str(), &s)) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc, db.handle()));
+    }
+    return snapshot(s);
+#else
+    RETURN_UNEXPECTED(create_snapshot_unsupported_error());
+#endif
+}
+
+} // namespace sqlite
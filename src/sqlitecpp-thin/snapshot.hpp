@@ -0,0 +1,66 @@
+#pragma once
+
+#include "sqlite3.hpp"
+#include "transaction.hpp"
+
+namespace sqlite
+{
+
+// True if SQLite was built with SQLITE_ENABLE_SNAPSHOT. Otherwise `get_snapshot()` and the `begin_read_transaction()`
+// of a snapshot fail with SQLITE_ERROR.
+bool snapshots_supported();
+
+// A read snapshot of a database in WAL mode, see `get_snapshot()`.
+//
+// Read transactions on other connections to the same database can be started on the snapshot, so they all see the same
+// state of the database, whatever was committed meanwhile:
+//
+//     auto tx = sqlite::begin_read_transaction(db).value();
+//     auto s = sqlite::get_snapshot(db).value();
+//     // On each worker thread, with its own connection:
+//     auto worker_tx = sqlite::begin_read_transaction(worker_db, s).value();
+//
+// A snapshot can be opened only as long as the WAL file isn't restarted by a checkpoint, which a read transaction on
+// the snapshot prevents. So keep the transaction of the coordinating connection open until the workers have started
+// theirs. A `snapshot` can be used from several threads at once.
+class snapshot
+{
+public:
+    explicit snapshot(sqlite3_snapshot* s);
+
+    // `snapshot` is move-only
+    snapshot(const snapshot&) = delete;
+    snapshot(snapshot&& y);
+    snapshot& operator=(const snapshot&) = delete;
+    snapshot& operator=(snapshot&& y);
+
+    // sqlite3_snapshot_free().
+    ~snapshot();
+
+    sqlite3_snapshot* handle() const
+    {
+        return _snapshot;
+    }
+
+    // sqlite3_snapshot_cmp(): negative if `this` is older than `y`, zero if they are the same, positive if it's newer.
+    // Only meaningful for snapshots of the same database, taken since the WAL file was last deleted.
+    int compare(const snapshot& y) const;
+
+private:
+    sqlite3_snapshot* _snapshot;
+};
+
+// BEGIN and read the schema of the "main" database, so the read transaction holds its snapshot from now on instead of
+// from its first query. If a transaction is already active, this is a savepoint, see `begin_transaction()`.
+expected<transaction, current_error> begin_read_transaction(database& db);
+
+// BEGIN and sqlite3_snapshot_open(): a read transaction on `s`, which may come from another connection to the same
+// database. Fails with SQLITE_ERROR_SNAPSHOT if the snapshot is no longer available, and with SQLITE_ERROR if a
+// transaction is already active.
+expected<transaction, error> begin_read_transaction(database& db, const snapshot& s, string_like_zt schema = "main");
+
+// sqlite3_snapshot_get(): the snapshot of the read transaction active on `db`, e.g. started by
+// `begin_read_transaction()`. The database must be in WAL mode.
+expected<snapshot, error> get_snapshot(database& db, string_like_zt schema = "main");
+
+} // namespace sqlite
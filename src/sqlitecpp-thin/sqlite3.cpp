@@ -75,6 +75,141 @@ expected<database, error> open(const fs::path& filename, int flags)
     return open(reinterpret_cast<const char*>(u8string.c_str()), flags);
 }
 
+open_options open_options::bulk_load()
+{
+    return open_options{
+      .journal = journal_mode::memory,
+      .synchronous = synchronous_mode::off,
+      .cache_size = -256 * 1024,
+      .temp_store = temp_store_mode::memory
+    };
+}
+
+open_options open_options::oltp_wal()
+{
+    return open_options{
+      .journal = journal_mode::wal,
+      .synchronous = synchronous_mode::normal,
+      .cache_size = -64 * 1024,
+      .temp_store = temp_store_mode::memory,
+      .busy_timeout_ms = 5000
+    };
+}
+
+open_options open_options::read_only_mmap()
+{
+    return open_options{
+      .flags = SQLITE_OPEN_READONLY,
+      .cache_size = -16 * 1024,
+      .mmap_size = int64_t(1) << 30,
+      .temp_store = temp_store_mode::memory,
+      .busy_timeout_ms = 5000
+    };
+}
+
+namespace
+{
+const char* journal_mode_name(journal_mode m)
+{
+    switch (m) {
+    case journal_mode::delete_:
+        return "DELETE";
+    case journal_mode::truncate:
+        return "TRUNCATE";
+    case journal_mode::persist:
+        return "PERSIST";
+    case journal_mode::memory:
+        return "MEMORY";
+    case journal_mode::wal:
+        return "WAL";
+    case journal_mode::off:
+        return "OFF";
+    }
+    assert(false);
+    return "DELETE";
+}
+
+string pragmas_sql(const open_options& options)
+{
+    string sql;
+    auto add = [&sql](const char* name, const string& value) {
+        sql += "PRAGMA ";
+        sql += name;
+        sql += " = ";
+        sql += value;
+        sql += ";\n";
+    };
+    if (options.page_size) {
+        add("page_size", std::to_string(*options.page_size));
+    }
+    if (options.journal) {
+        add("journal_mode", journal_mode_name(*options.journal));
+    }
+    if (options.synchronous) {
+        add("synchronous", std::to_string(int(*options.synchronous)));
+    }
+    if (options.cache_size) {
+        add("cache_size", std::to_string(*options.cache_size));
+    }
+    if (options.mmap_size) {
+        add("mmap_size", std::to_string(*options.mmap_size));
+    }
+    if (options.temp_store) {
+        add("temp_store", std::to_string(int(*options.temp_store)));
+    }
+    return sql;
+}
+} // namespace
+
+expected<database, error> open(const char* filename, const open_options& options)
+{
+    auto db = open(filename, options.flags);
+#if SQLITECPPTHIN_EXPECTED
+    if (!db) {
+        return db;
+    }
+    database& d = *db;
+#else
+    database& d = db;
+#endif
+    // On error `db` is closed by its destructor.
+    if (options.lookaside) {
+        RETURN_IF_UNEXPECTED(d.db_config_lookaside(options.lookaside->slot_size, options.lookaside->slot_count));
+    }
+    if (options.busy_timeout_ms) {
+        if (sqlite3_busy_timeout(d.handle(), *options.busy_timeout_ms) != SQLITE_OK) {
+            RETURN_UNEXPECTED(create_error_for_db(d.handle()));
+        }
+    }
+    if (options.busy) {
+        d.set_busy_policy(*options.busy);
+    }
+    for (const auto& sql : {pragmas_sql(options), options.init_sql}) {
+        if (sql.empty()) {
+            continue;
+        }
+#if SQLITECPPTHIN_EXPECTED
+        if (auto r = d.exec(sql); !r) {
+            RETURN_UNEXPECTED(r.error().get_error());
+        }
+#else
+        d.exec(sql);
+#endif
+    }
+    return db;
+}
+
+expected<database, error> open(const string& filename, const open_options& options)
+{
+    return open(filename.c_str(), options);
+}
+
+expected<database, error> open(const fs::path& filename, const open_options& options)
+{
+    auto u8string = filename.u8string();
+    return open(reinterpret_cast<const char*>(u8string.c_str()), options);
+}
+
 const char* errcode_macro_name(int rc)
 {
 #define CASE(X) \
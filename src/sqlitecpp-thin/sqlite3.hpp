@@ -2,20 +2,27 @@
 
 #include "sqlite3.h"
 
+#include <cassert>
+#include <chrono>
 #include <concepts>
 #include <cstdint>
-#if defined SQLITECPPTHIN_EXCEPTION && SQLITECPPTHIN_EXCEPTION
-  #include <exception>
-#endif
+#include <exception>
 #if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
   #include <expected>
 #endif
 #include <filesystem>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <optional>
 #include <span>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace sqlite
 {
@@ -33,10 +40,15 @@ namespace fs = std::filesystem;
 template<class T, class E>
 using expected = std::expected<T, E>;
   #define SQLITECPPTHIN_NODISCARD [[nodiscard]]
+  // Error reporting in the inline functions, see also `RETURN_UNEXPECTED` and `RETURN_VOID` in "common.hpp".
+  #define SQLITECPPTHIN_RETURN_UNEXPECTED(X) return std::unexpected(X)
+  #define SQLITECPPTHIN_RETURN_VOID return {}
 #elif defined SQLITECPPTHIN_EXCEPTION && SQLITECPPTHIN_EXCEPTION
 template<class T, class E>
 using expected = T;
   #define SQLITECPPTHIN_NODISCARD
+  #define SQLITECPPTHIN_RETURN_UNEXPECTED(X) throw(sqlite::exception(X))
+  #define SQLITECPPTHIN_RETURN_VOID return
 #else
   #error Include "sqlitecpp-thin/sqlite3-expected.hpp" or "sqlitecpp-thin/sqlite3-exception.hpp" instead.
 #endif
@@ -67,6 +79,7 @@ struct string_like {
     // string literals, too.
     string_like(std::same_as<const char*> auto cc)
         : _c_str(cc)
+        , _size()
     {
     }
 
@@ -180,10 +193,673 @@ enum class datatype {
 // Return the name of the C macro (e.g. "SQLITE_BUSY") for the error code. `nullptr` if the error code is not valid.
 const char* errcode_macro_name(int rc);
 
+// Column decoders for the typed row access functions like `statement::rows()`. They call the `sqlite3_column_*()`
+// functions without error checking, the caller is expected to check `sqlite3_errcode()` once per row.
+// Specialize it for user types if needed.
+template<class T>
+struct column_decoder;
+
+template<>
+struct column_decoder<int> {
+    static int decode(sqlite3_stmt* stmt, int col)
+    {
+        return sqlite3_column_int(stmt, col);
+    }
+};
+
+template<>
+struct column_decoder<int64_t> {
+    static int64_t decode(sqlite3_stmt* stmt, int col)
+    {
+        return sqlite3_column_int64(stmt, col);
+    }
+};
+
+template<>
+struct column_decoder<double> {
+    static double decode(sqlite3_stmt* stmt, int col)
+    {
+        return sqlite3_column_double(stmt, col);
+    }
+};
+
+// Valid until the next step or reset.
+template<>
+struct column_decoder<string_view> {
+    static string_view decode(sqlite3_stmt* stmt, int col)
+    {
+        auto* p = reinterpret_cast<const char*>(sqlite3_column_text(stmt, col));
+        return p ? string_view(p, size_t(sqlite3_column_bytes(stmt, col))) : string_view();
+    }
+};
+
+template<>
+struct column_decoder<string> {
+    static string decode(sqlite3_stmt* stmt, int col)
+    {
+        return string(column_decoder<string_view>::decode(stmt, col));
+    }
+};
+
+// Valid until the next step or reset.
+template<>
+struct column_decoder<span<const byte>> {
+    static span<const byte> decode(sqlite3_stmt* stmt, int col)
+    {
+        auto* p = reinterpret_cast<const byte*>(sqlite3_column_blob(stmt, col));
+        return p ? span<const byte>(p, size_t(sqlite3_column_bytes(stmt, col))) : span<const byte>();
+    }
+};
+
+// NULL is decoded as std::nullopt.
+template<class T>
+struct column_decoder<optional<T>> {
+    static optional<T> decode(sqlite3_stmt* stmt, int col)
+    {
+        if (sqlite3_column_type(stmt, col) == SQLITE_NULL) {
+            return std::nullopt;
+        }
+        return column_decoder<T>::decode(stmt, col);
+    }
+};
+
+// Column accessors without per-call error checking, returned by `statement::unchecked()`.
+//
+// The checked `statement::column_*()` functions call sqlite3_errcode() whenever the value is zero or NULL, since that
+// is how the C API reports allocation failures during type conversions. For sparse data this means an extra call for
+// most columns. These accessors return the raw values, the caller should call `check()` once after reading the row.
+// The `_opt` variants test for NULL with a single sqlite3_column_type() call before reading the value.
+class unchecked_columns
+{
+public:
+    explicit unchecked_columns(sqlite3_stmt* stmt)
+        : _stmt(stmt)
+    {
+    }
+
+    unchecked_columns(const unchecked_columns&) = default;
+    unchecked_columns& operator=(const unchecked_columns&) = default;
+
+    int column_int(int col) const
+    {
+        return column_decoder<int>::decode(_stmt, col);
+    }
+
+    int64_t column_int64(int col) const
+    {
+        return column_decoder<int64_t>::decode(_stmt, col);
+    }
+
+    double column_double(int col) const
+    {
+        return column_decoder<double>::decode(_stmt, col);
+    }
+
+    // Valid until the next step or reset.
+    string_view column_text(int col) const
+    {
+        return column_decoder<string_view>::decode(_stmt, col);
+    }
+
+    // Valid until the next step or reset.
+    span<const byte> column_blob(int col) const
+    {
+        return column_decoder<span<const byte>>::decode(_stmt, col);
+    }
+
+    datatype column_type(int col) const
+    {
+        return datatype(sqlite3_column_type(_stmt, col));
+    }
+
+    optional<int> column_int_opt(int col) const
+    {
+        return column_decoder<optional<int>>::decode(_stmt, col);
+    }
+
+    optional<int64_t> column_int64_opt(int col) const
+    {
+        return column_decoder<optional<int64_t>>::decode(_stmt, col);
+    }
+
+    optional<double> column_double_opt(int col) const
+    {
+        return column_decoder<optional<double>>::decode(_stmt, col);
+    }
+
+    optional<string_view> column_text_opt(int col) const
+    {
+        return column_decoder<optional<string_view>>::decode(_stmt, col);
+    }
+
+    optional<span<const byte>> column_blob_opt(int col) const
+    {
+        return column_decoder<optional<span<const byte>>>::decode(_stmt, col);
+    }
+
+    // Report the errors of the accessors called since the last step, using a single sqlite3_errcode() call.
+    expected<void, current_error> check() const
+    {
+        auto* db = sqlite3_db_handle(_stmt);
+        if (int rc = sqlite3_errcode(db); rc != SQLITE_OK && rc != SQLITE_ROW && rc != SQLITE_DONE) {
+            SQLITECPPTHIN_RETURN_UNEXPECTED(current_error(rc, db));
+        }
+        SQLITECPPTHIN_RETURN_VOID;
+    }
+
+private:
+    sqlite3_stmt* _stmt;
+};
+
+// Argument decoders of the user-defined functions, see `database::create_function()`. Like `column_decoder`, they
+// call the `sqlite3_value_*()` functions without error checking. Specialize it for user types if needed.
+template<class T>
+struct value_decoder;
+
+template<>
+struct value_decoder<int> {
+    static int decode(sqlite3_value* v)
+    {
+        return sqlite3_value_int(v);
+    }
+};
+
+template<>
+struct value_decoder<int64_t> {
+    static int64_t decode(sqlite3_value* v)
+    {
+        return sqlite3_value_int64(v);
+    }
+};
+
+template<>
+struct value_decoder<double> {
+    static double decode(sqlite3_value* v)
+    {
+        return sqlite3_value_double(v);
+    }
+};
+
+template<>
+struct value_decoder<bool> {
+    static bool decode(sqlite3_value* v)
+    {
+        return sqlite3_value_int64(v) != 0;
+    }
+};
+
+// Valid until the function returns.
+template<>
+struct value_decoder<string_view> {
+    static string_view decode(sqlite3_value* v)
+    {
+        auto* p = reinterpret_cast<const char*>(sqlite3_value_text(v));
+        return p ? string_view(p, size_t(sqlite3_value_bytes(v))) : string_view();
+    }
+};
+
+template<>
+struct value_decoder<string> {
+    static string decode(sqlite3_value* v)
+    {
+        return string(value_decoder<string_view>::decode(v));
+    }
+};
+
+// Valid until the function returns.
+template<>
+struct value_decoder<span<const byte>> {
+    static span<const byte> decode(sqlite3_value* v)
+    {
+        auto* p = reinterpret_cast<const byte*>(sqlite3_value_blob(v));
+        return p ? span<const byte>(p, size_t(sqlite3_value_bytes(v))) : span<const byte>();
+    }
+};
+
+// The raw value, for dynamically typed arguments.
+template<>
+struct value_decoder<sqlite3_value*> {
+    static sqlite3_value* decode(sqlite3_value* v)
+    {
+        return v;
+    }
+};
+
+// NULL is decoded as std::nullopt.
+template<class T>
+struct value_decoder<optional<T>> {
+    static optional<T> decode(sqlite3_value* v)
+    {
+        if (sqlite3_value_type(v) == SQLITE_NULL) {
+            return std::nullopt;
+        }
+        return value_decoder<T>::decode(v);
+    }
+};
+
+// Result setters of the user-defined functions, see `database::create_function()`. Specialize it for user types if
+// needed.
+template<class T>
+struct function_result;
+
+template<>
+struct function_result<int> {
+    static void set(sqlite3_context* ctx, int x)
+    {
+        sqlite3_result_int(ctx, x);
+    }
+};
+
+template<>
+struct function_result<int64_t> {
+    static void set(sqlite3_context* ctx, int64_t x)
+    {
+        sqlite3_result_int64(ctx, x);
+    }
+};
+
+template<>
+struct function_result<double> {
+    static void set(sqlite3_context* ctx, double x)
+    {
+        sqlite3_result_double(ctx, x);
+    }
+};
+
+template<>
+struct function_result<bool> {
+    static void set(sqlite3_context* ctx, bool x)
+    {
+        sqlite3_result_int(ctx, x ? 1 : 0);
+    }
+};
+
+template<>
+struct function_result<string_view> {
+    static void set(sqlite3_context* ctx, string_view x)
+    {
+        // Like `bind_text()`: empty is never NULL, even if `data() == nullptr`.
+        sqlite3_result_text64(ctx, x.empty() ? "" : x.data(), x.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+    }
+};
+
+template<>
+struct function_result<string> {
+    static void set(sqlite3_context* ctx, const string& x)
+    {
+        function_result<string_view>::set(ctx, x);
+    }
+};
+
+template<>
+struct function_result<span<const byte>> {
+    static void set(sqlite3_context* ctx, span<const byte> x)
+    {
+        static const byte k_byte{};
+        sqlite3_result_blob64(ctx, x.empty() ? &k_byte : x.data(), x.size(), SQLITE_TRANSIENT);
+    }
+};
+
+template<>
+struct function_result<std::nullopt_t> {
+    static void set(sqlite3_context* ctx, std::nullopt_t)
+    {
+        sqlite3_result_null(ctx);
+    }
+};
+
+// std::nullopt is returned as NULL.
+template<class T>
+struct function_result<optional<T>> {
+    static void set(sqlite3_context* ctx, const optional<T>& x)
+    {
+        if (x) {
+            function_result<T>::set(ctx, *x);
+        } else {
+            sqlite3_result_null(ctx);
+        }
+    }
+};
+
+// Signature of a callable with a single, non-template call operator, or of a function pointer. A single
+// `span<sqlite3_value* const>` parameter takes any number of arguments.
+template<class F>
+struct callable_traits : callable_traits<decltype(&F::operator())> {};
+
+template<class R, class... Args>
+struct callable_traits<R (*)(Args...)> {
+    using result_type = R;
+    using args_tuple = std::tuple<std::decay_t<Args>...>;
+    static constexpr bool variadic = std::is_same_v<args_tuple, std::tuple<span<sqlite3_value* const>>>;
+    // Number of SQL arguments, -1 if variadic.
+    static constexpr int arity = variadic ? -1 : int(sizeof...(Args));
+};
+
+template<class R, class... Args>
+struct callable_traits<R (*)(Args...) noexcept> : callable_traits<R (*)(Args...)> {};
+
+template<class C, class R, class... Args>
+struct callable_traits<R (C::*)(Args...)> : callable_traits<R (*)(Args...)> {};
+
+template<class C, class R, class... Args>
+struct callable_traits<R (C::*)(Args...) const> : callable_traits<R (*)(Args...)> {};
+
+template<class C, class R, class... Args>
+struct callable_traits<R (C::*)(Args...) noexcept> : callable_traits<R (*)(Args...)> {};
+
+template<class C, class R, class... Args>
+struct callable_traits<R (C::*)(Args...) const noexcept> : callable_traits<R (*)(Args...)> {};
+
+// Set the result of a user-defined function to the exception in flight. Call only from a catch block.
+inline void set_function_result_from_exception(sqlite3_context* ctx)
+{
+    try {
+        throw;
+    } catch (const std::bad_alloc&) {
+        sqlite3_result_error_nomem(ctx);
+    } catch (const std::exception& e) {
+        sqlite3_result_error(ctx, e.what(), -1);
+    } catch (...) {
+        sqlite3_result_error(ctx, "unknown exception in user-defined function", -1);
+    }
+}
+
+// Call `f` with `argv` decoded as the parameters described by `Traits`, see `callable_traits`.
+template<class Traits, class F>
+decltype(auto) call_with_values(F&& f, [[maybe_unused]] int argc, sqlite3_value** argv)
+{
+    using args_tuple = typename Traits::args_tuple;
+    if constexpr (Traits::variadic) {
+        return f(span<sqlite3_value* const>(argv, size_t(argc)));
+    } else {
+        return [&]<size_t... Is>(std::index_sequence<Is...>) -> decltype(auto) {
+            return f(value_decoder<std::tuple_element_t<Is, args_tuple>>::decode(argv[Is])...);
+        }(std::make_index_sequence<std::tuple_size_v<args_tuple>>{});
+    }
+}
+
+// Set the result of `call()` on `ctx`, `void` as NULL.
+template<class F>
+void set_function_result(sqlite3_context* ctx, F&& call)
+{
+    using result_type = std::decay_t<std::invoke_result_t<F&>>;
+    if constexpr (std::is_void_v<result_type>) {
+        call();
+        sqlite3_result_null(ctx);
+    } else {
+        function_result<result_type>::set(ctx, call());
+    }
+}
+
+// Call `f` with the decoded `argv` and set its result on `ctx`. Exceptions are reported as SQL errors.
+template<class F>
+void invoke_function(sqlite3_context* ctx, F& f, int argc, sqlite3_value** argv)
+{
+    try {
+        set_function_result(ctx, [&]() -> decltype(auto) {
+            return call_with_values<callable_traits<std::decay_t<F>>>(f, argc, argv);
+        });
+    } catch (...) {
+        set_function_result_from_exception(ctx);
+    }
+}
+
+// Fixed-size blocks for the aggregate states which don't fit in the aggregate context, carved from 64 KiB chunks and
+// recycled through a free list. The chunks are released only with the arena. Not thread-safe: SQLite calls the
+// functions of a connection from one thread at a time.
+class aggregate_state_arena
+{
+public:
+    aggregate_state_arena(size_t block_size, size_t block_alignment);
+    ~aggregate_state_arena();
+
+    aggregate_state_arena(const aggregate_state_arena&) = delete;
+    aggregate_state_arena& operator=(const aggregate_state_arena&) = delete;
+
+    void* allocate();
+    void deallocate(void* p);
+
+private:
+    struct free_block {
+        free_block* next;
+    };
+
+    size_t _block_alignment;
+    size_t _block_size;
+    size_t _blocks_per_chunk;
+    std::vector<byte*> _chunks;
+    free_block* _free_list;
+};
+
+// The callbacks of `database::create_aggregate<State>()`, the user data of the SQL function.
+//
+// States up to `k_max_inline_size` bytes are placement-constructed in the aggregate context, which SQLite allocates
+// per group from the lookaside or the heap and frees after xFinal. The larger states are allocated from the arena and
+// the aggregate context holds only a pointer.
+template<class State>
+class aggregate_function
+{
+public:
+    static constexpr size_t k_max_inline_size = 256;
+    // sqlite3_aggregate_context() returns 8-byte aligned memory.
+    static constexpr bool is_inline = sizeof(State) <= k_max_inline_size && alignof(State) <= 8;
+    static constexpr bool is_window = requires {
+        &State::inverse;
+        &State::value;
+    };
+    using step_traits = callable_traits<decltype(&State::step)>;
+
+    aggregate_function()
+        : _arena(sizeof(State), alignof(State))
+    {
+    }
+
+    static void x_step(sqlite3_context* ctx, int argc, sqlite3_value** argv)
+    {
+        call_member<&State::step, step_traits>(ctx, argc, argv);
+    }
+
+    static void x_inverse(sqlite3_context* ctx, int argc, sqlite3_value** argv)
+    {
+        call_member<&State::inverse, callable_traits<decltype(&State::inverse)>>(ctx, argc, argv);
+    }
+
+    static void x_value(sqlite3_context* ctx)
+    {
+        set_result<&State::value>(ctx, get_state(ctx, false));
+    }
+
+    static void x_final(sqlite3_context* ctx)
+    {
+        State* state = get_state(ctx, false);
+        set_result<&State::final>(ctx, state);
+        if (state) {
+            state->~State();
+            if constexpr (!is_inline) {
+                static_cast<aggregate_function*>(sqlite3_user_data(ctx))->_arena.deallocate(state);
+            }
+        }
+    }
+
+    static void x_destroy(void* p)
+    {
+        delete static_cast<aggregate_function*>(p);
+    }
+
+private:
+    struct inline_slot {
+        alignas(State) byte storage[sizeof(State)];
+        bool constructed;
+    };
+    struct arena_slot {
+        State* state;
+    };
+    using slot = std::conditional_t<is_inline, inline_slot, arena_slot>;
+
+    // Return the state of the current group, constructing it if `create`. Return nullptr if it doesn't exist and
+    // `create` is false, or if SQLite is out of memory.
+    static State* get_state(sqlite3_context* ctx, bool create)
+    {
+        auto* s = static_cast<slot*>(sqlite3_aggregate_context(ctx, create ? int(sizeof(slot)) : 0));
+        if (!s) {
+            return nullptr;
+        }
+        if constexpr (is_inline) {
+            if (!s->constructed) {
+                if (!create) {
+                    return nullptr;
+                }
+                ::new (s->storage) State();
+                s->constructed = true;
+            }
+            return std::launder(reinterpret_cast<State*>(s->storage));
+        } else {
+            if (!s->state && create) {
+                auto& arena = static_cast<aggregate_function*>(sqlite3_user_data(ctx))->_arena;
+                void* p = arena.allocate();
+                try {
+                    s->state = ::new (p) State();
+                } catch (...) {
+                    arena.deallocate(p);
+                    throw;
+                }
+            }
+            return s->state;
+        }
+    }
+
+    template<auto Member, class Traits>
+    static void call_member(sqlite3_context* ctx, int argc, sqlite3_value** argv)
+    {
+        try {
+            State* state = get_state(ctx, true);
+            if (!state) {
+                sqlite3_result_error_nomem(ctx);
+                return;
+            }
+            call_with_values<Traits>(
+              [state](auto&&... args) {
+                  (state->*Member)(std::forward<decltype(args)>(args)...);
+              },
+              argc,
+              argv
+            );
+        } catch (...) {
+            set_function_result_from_exception(ctx);
+        }
+    }
+
+    // Set the result of `(state->*Member)()`, of a default-constructed state if `state` is null (no rows).
+    template<auto Member>
+    static void set_result(sqlite3_context* ctx, State* state)
+    {
+        try {
+            optional<State> empty;
+            if (!state) {
+                state = &empty.emplace();
+            }
+            set_function_result(ctx, [state]() -> decltype(auto) {
+                return (state->*Member)();
+            });
+        } catch (...) {
+            set_function_result_from_exception(ctx);
+        }
+    }
+
+    aggregate_state_arena _arena;
+};
+
+template<class... Ts>
+class row_range;
+
+class metrics;
+class statement_metrics;
+
+// Integers which can safely be converted to `int`, bound with sqlite3_bind_int().
+template<class T>
+concept int_bindable =
+  (std::signed_integral<T> && sizeof(T) <= sizeof(int)) || (std::unsigned_integral<T> && sizeof(T) + 1 <= sizeof(int));
+
+// Integers which can safely be converted to `int64_t`, bound with sqlite3_bind_int64().
+template<class T>
+concept int64_bindable = (std::signed_integral<T> && sizeof(T) <= sizeof(int64_t))
+                      || (std::unsigned_integral<T> && sizeof(T) + 1 <= sizeof(int64_t));
+
+// Column types supported by `statement::fetch_columns()`.
+template<class T>
+concept fetchable_column = std::same_as<T, int> || std::same_as<T, int64_t> || std::same_as<T, double>;
+
+// Validity bitmap of a column fetched by `statement::fetch_columns()`: bit `i` is set if the value in row `i` is not
+// NULL. Bits are stored in 64-bit words, least significant bit first.
+class validity_bitmap
+{
+public:
+    void push_back(bool valid)
+    {
+        if (_size % 64 == 0) {
+            _words.push_back(0);
+        }
+        _words.back() |= uint64_t(valid) << (_size % 64);
+        ++_size;
+    }
+
+    bool operator[](size_t i) const
+    {
+        return (_words[i / 64] >> (i % 64)) & 1;
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    span<const uint64_t> words() const
+    {
+        return _words;
+    }
+
+    void reserve(size_t size)
+    {
+        _words.reserve((size + 63) / 64);
+    }
+
+    void clear()
+    {
+        _words.clear();
+        _size = 0;
+    }
+
+private:
+    std::vector<uint64_t> _words;
+    size_t _size = 0;
+};
+
+// Counters of sqlite3_stmt_status(), see the SQLITE_STMTSTATUS_* constants.
+struct statement_status {
+    // Steps in full table scans, a large value may indicate a missing index.
+    int fullscan_step = 0;
+    // Sort operations, a nonzero value may indicate a missing index for ORDER BY or GROUP BY.
+    int sort = 0;
+    // Rows inserted into automatic indexes, a nonzero value may indicate a missing index.
+    int autoindex = 0;
+    // Virtual machine operations.
+    int vm_step = 0;
+    // Automatic re-prepares after schema changes.
+    int reprepare = 0;
+    // Runs to completion or reset.
+    int run = 0;
+    // Bloom filter bypasses and hits of join lookups.
+    int filter_miss = 0;
+    int filter_hit = 0;
+    // Approximate memory used by the statement, in bytes. Not affected by `reset`.
+    int memused = 0;
+};
+
 class statement
 {
 public:
-    explicit statement(sqlite3_stmt* stmt);
+    // `stmt_metrics` is installed by `database::prepare()` if the database has a metrics sink, see `metrics`.
+    explicit statement(sqlite3_stmt* stmt, statement_metrics* stmt_metrics = nullptr);
 
     // `statement` is move-only
     statement(const statement&) = delete;
@@ -255,10 +931,7 @@ public:
 
     // Accept all integers which can safely be converted to `int` (and exclude `int` itself)
     template<class T>
-        requires(
-          !std::same_as<T, int>
-          && ((std::signed_integral<T> && sizeof(T) <= sizeof(int)) || (std::unsigned_integral<T> && sizeof(T) + 1 <= sizeof(int)))
-        )
+        requires(!std::same_as<T, int> && int_bindable<T>)
     SQLITECPPTHIN_NODISCARD expected<void, current_error> bind_int(int index, T i)
     {
         return bind_int(index, int(i));
@@ -266,10 +939,7 @@ public:
 
     // Accept all integers which can safely be converted to `int64_t` (and exclude `int64_t` itself)
     template<class T>
-        requires(
-          !std::same_as<T, int64_t>
-          && ((std::signed_integral<T> && sizeof(T) <= sizeof(int64_t)) || (std::unsigned_integral<T> && sizeof(T) + 1 <= sizeof(int64_t)))
-        )
+        requires(!std::same_as<T, int64_t> && int64_bindable<T> && !int_bindable<T>)
     SQLITECPPTHIN_NODISCARD expected<void, current_error> bind_int(int index, T i)
     {
         return bind_int(index, int64_t(i));
@@ -319,6 +989,39 @@ public:
     // sqlite3_bind_zeroblob64().
     SQLITECPPTHIN_NODISCARD expected<void, current_error> bind_zeroblob(int index, size_t size);
 
+    // bind_array functions: sqlite3_bind_pointer() of `values` for the table-valued function registered with
+    // `register_carray()` (vtab.hpp), which returns them in order in its `value` column. A single prepared statement
+    // serves any number of values:
+    //
+    //     auto stmt = db.prepare("SELECT * FROM t WHERE id IN carray(?)");
+    //     stmt.bind_array(1, ids);
+    //
+    // The values are read in place: like with `bind_text()`, the memory must be kept alive until the next rebind or
+    // the end of the statement. For other uses in SQL the parameter is NULL.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> bind_array(int index, span<const int64_t> values);
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> bind_array(int index, span<const double> values);
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> bind_array(int index, span<const string_view> values);
+
+    // Bind all arguments to the parameters 1, 2, ..., N. The `sqlite3_bind_*()` function is selected at compile time
+    // for each argument type, following the rules of the `bind_*` functions above:
+    //
+    // - integers: sqlite3_bind_int() or sqlite3_bind_int64(), like `bind_int()`
+    // - double: sqlite3_bind_double()
+    // - const char*, string_view, const string&: sqlite3_bind_text64(..., SQLITE_STATIC), like `bind_text()`
+    // - span<const byte>: sqlite3_bind_blob64(..., SQLITE_STATIC), like `bind_blob()`
+    // - std::nullopt, nullptr: sqlite3_bind_null()
+    // - optional<T>: T or NULL
+    //
+    // Binding stops at the first error, the result is checked only once at the end.
+    template<class... Args>
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> bind_all(Args&&... args)
+    {
+        if (int rc = bind_all_unchecked(std::forward<Args>(args)...)) {
+            SQLITECPPTHIN_RETURN_UNEXPECTED(current_error(rc, db_handle()));
+        }
+        SQLITECPPTHIN_RETURN_VOID;
+    }
+
     expected<step_result, current_error> step();
 
     // Normal column getters:
@@ -353,16 +1056,446 @@ public:
     // sqlite3_reset().
     expected<void, current_error> reset();
 
+    // sqlite3_clear_bindings().
+    expected<void, current_error> clear_bindings();
+
     // sqlite3_db_handle().
     sqlite3* db_handle() const;
 
+    // Column accessors without per-call error checking, see `unchecked_columns`.
+    unchecked_columns unchecked() const
+    {
+        return unchecked_columns(_stmt);
+    }
+
+    // sqlite3_stmt_status() for all counters, reset them to zero if `reset` is true.
+    statement_status status(bool reset = false) const;
+
     // Convenience compound functions:
 
     // sqlite3_step(), verify it's SQLITE_DONE, then return sqlite3_changes().
     expected<int, current_error> step_done_changes();
 
+    // sqlite3_reset(), `bind_all(args...)` then `step_done_changes()`, with a single error check at the end.
+    template<class... Args>
+    expected<int, current_error> execute(Args&&... args)
+    {
+        // The result of sqlite3_reset() is the error of the previous step, if any, that's not reported here.
+        sqlite3_reset(_stmt);
+        int rc = bind_all_unchecked(std::forward<Args>(args)...);
+        if (rc == SQLITE_OK) {
+            rc = step_rc();
+            if (rc == SQLITE_DONE) {
+                return sqlite3_changes(db_handle());
+            }
+            // SQLITE_ROW is reported as error.
+        }
+        SQLITECPPTHIN_RETURN_UNEXPECTED(current_error(rc, db_handle()));
+    }
+
+    // Iterate over the remaining rows as `std::tuple<Ts...>`, the columns are decoded with `column_decoder<Ts>`:
+    //
+    //     for (auto [id, name, score] : stmt.rows<int64_t, string_view, optional<double>>()) { ... }
+    //
+    // Errors are checked once per row. In the exception-style lib they're thrown, in the `std::expected`-style lib
+    // they end the iteration and can be retrieved with `row_range::get_error()`.
+    template<class... Ts>
+    row_range<Ts...> rows();
+
+    // Step up to `max_rows` rows and append column `i` of each row to `columns[i]` (struct-of-arrays layout). NULL
+    // values are appended as zero.
+    // Returns the number of rows fetched. Fewer than `max_rows` rows means the statement is done (the next step
+    // would restart it).
+    template<fetchable_column... Ts>
+    expected<size_t, current_error> fetch_columns(size_t max_rows, std::vector<Ts>&... columns)
+    {
+        return fetch_columns(max_rows, span<validity_bitmap>(), columns...);
+    }
+
+    // Same as above, also appending the NULL-ness of each value to `validity[i]`. `validity` must be either empty or
+    // have one bitmap for each column.
+    template<fetchable_column... Ts>
+    expected<size_t, current_error>
+    fetch_columns(size_t max_rows, span<validity_bitmap> validity, std::vector<Ts>&... columns)
+    {
+        assert(validity.empty() || validity.size() == sizeof...(Ts));
+        auto* db = db_handle();
+        size_t num_rows = 0;
+        for (; num_rows < max_rows; ++num_rows) {
+            int rc = step_rc();
+            if (rc == SQLITE_ROW) {
+                if (validity.empty()) {
+                    int col = 0;
+                    (columns.push_back(column_decoder<Ts>::decode(_stmt, col++)), ...);
+                } else {
+                    append_row_with_validity(validity, std::index_sequence_for<Ts...>{}, columns...);
+                }
+                // Type conversions may fail with SQLITE_NOMEM.
+                rc = sqlite3_errcode(db);
+                if (rc == SQLITE_ROW || rc == SQLITE_OK) {
+                    continue;
+                }
+            } else if (rc == SQLITE_DONE) {
+                break;
+            }
+            SQLITECPPTHIN_RETURN_UNEXPECTED(current_error(rc, db));
+        }
+        return num_rows;
+    }
+
 private:
+    template<class... Ts>
+    friend class row_range;
+
+    // sqlite3_step(), recording the metrics if installed.
+    int step_rc()
+    {
+        return _metrics ? step_rc_with_metrics() : sqlite3_step(_stmt);
+    }
+
+    int step_rc_with_metrics();
+
+    // sqlite3_bind_pointer() of the array for `bind_array()`, `type` is SQLITE_INTEGER, SQLITE_FLOAT or SQLITE_TEXT.
+    expected<void, current_error> bind_array_pointer(int index, const void* data, size_t size, int type);
+
+    // Overloads for `bind_all()`, return the result code of the `sqlite3_bind_*()` function.
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, int i)
+    {
+        return sqlite3_bind_int(stmt, index, i);
+    }
+
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, int64_t i)
+    {
+        return sqlite3_bind_int64(stmt, index, i);
+    }
+
+    template<class T>
+        requires(!std::same_as<T, int> && int_bindable<T>)
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, T i)
+    {
+        return sqlite3_bind_int(stmt, index, int(i));
+    }
+
+    template<class T>
+        requires(!std::same_as<T, int64_t> && int64_bindable<T> && !int_bindable<T>)
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, T i)
+    {
+        return sqlite3_bind_int64(stmt, index, int64_t(i));
+    }
+
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, double d)
+    {
+        return sqlite3_bind_double(stmt, index, d);
+    }
+
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, const char* ptr)
+    {
+        return sqlite3_bind_text(stmt, index, ptr, -1, SQLITE_STATIC);
+    }
+
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, string_view sv)
+    {
+        return sqlite3_bind_text64(stmt, index, sv.empty() ? "" : sv.data(), sv.size(), SQLITE_STATIC, SQLITE_UTF8);
+    }
+
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, const string& s)
+    {
+        return bind_unchecked(stmt, index, string_view(s));
+    }
+
+    // Temporary strings must always be copied, use `bind_text_copy()` for them.
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, string&& s) = delete;
+
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, span<const byte> bytes)
+    {
+        static const byte k_byte{};
+        return sqlite3_bind_blob64(
+          stmt, index, bytes.empty() ? &k_byte : bytes.data(), bytes.size(), SQLITE_STATIC
+        );
+    }
+
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, std::nullopt_t)
+    {
+        return sqlite3_bind_null(stmt, index);
+    }
+
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, std::nullptr_t)
+    {
+        return sqlite3_bind_null(stmt, index);
+    }
+
+    template<class T>
+    static int bind_unchecked(sqlite3_stmt* stmt, int index, const optional<T>& x)
+    {
+        return x ? bind_unchecked(stmt, index, *x) : sqlite3_bind_null(stmt, index);
+    }
+
+    template<size_t... Is, class... Ts>
+    void append_row_with_validity(
+      span<validity_bitmap> validity, std::index_sequence<Is...>, std::vector<Ts>&... columns
+    )
+    {
+        (
+          [&] {
+              bool valid = sqlite3_column_type(_stmt, int(Is)) != SQLITE_NULL;
+              validity[Is].push_back(valid);
+              columns.push_back(valid ? column_decoder<Ts>::decode(_stmt, int(Is)) : Ts());
+          }(),
+          ...
+        );
+    }
+
+    template<class... Args>
+    int bind_all_unchecked(Args&&... args)
+    {
+        int index = 0;
+        int rc = SQLITE_OK;
+        // Stop at the first error so `sqlite3_errcode()` still refers to it.
+        (void)(((rc = bind_unchecked(_stmt, ++index, std::forward<Args>(args))) == SQLITE_OK) && ...);
+        return rc;
+    }
+
     sqlite3_stmt* _stmt;
+    statement_metrics* _metrics;
+};
+
+// Single-pass range over the rows of a statement, see `statement::rows()`.
+template<class... Ts>
+class row_range
+{
+public:
+    using value_type = std::tuple<Ts...>;
+
+    explicit row_range(statement& stmt)
+        : _stmt(&stmt)
+        , _row()
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+        , _error()
+#endif
+    {
+    }
+
+    // The iterators refer to the range.
+    row_range(const row_range&) = delete;
+    row_range& operator=(const row_range&) = delete;
+
+    class iterator
+    {
+    public:
+        using value_type = row_range::value_type;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        explicit iterator(row_range* range)
+            : _range(range)
+        {
+        }
+
+        iterator(const iterator&) = default;
+        iterator& operator=(const iterator&) = default;
+
+        const value_type& operator*() const
+        {
+            return *_range->_row;
+        }
+
+        iterator& operator++()
+        {
+            _range->advance();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            auto was_this = *this;
+            _range->advance();
+            return was_this;
+        }
+
+        bool operator==(std::default_sentinel_t) const
+        {
+            return !_range->_row;
+        }
+
+    private:
+        row_range* _range = nullptr;
+    };
+
+    // Steps to the first row.
+    iterator begin()
+    {
+        advance();
+        return iterator(this);
+    }
+
+    std::default_sentinel_t end() const
+    {
+        return std::default_sentinel;
+    }
+
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+    // The error which ended the iteration, if any.
+    const optional<sqlite::error>& get_error() const
+    {
+        return _error;
+    }
+#endif
+
+private:
+    void advance()
+    {
+        _row.reset();
+        int rc = _stmt->step_rc();
+        if (rc == SQLITE_ROW) {
+            decode_row(std::index_sequence_for<Ts...>{});
+            // The column decoders may fail with SQLITE_NOMEM during type conversions.
+            rc = sqlite3_errcode(_stmt->db_handle());
+            if (rc == SQLITE_ROW || rc == SQLITE_OK) {
+                return;
+            }
+            _row.reset();
+        }
+        if (rc == SQLITE_DONE) {
+            return;
+        }
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+        _error = current_error(rc, _stmt->db_handle()).get_error();
+#else
+        throw exception(current_error(rc, _stmt->db_handle()));
+#endif
+    }
+
+    template<size_t... Is>
+    void decode_row(std::index_sequence<Is...>)
+    {
+        auto* h = _stmt->handle();
+        // Braced initialization guarantees left-to-right evaluation.
+        _row.emplace(value_type{column_decoder<Ts>::decode(h, int(Is))...});
+    }
+
+    statement* _stmt;
+    optional<value_type> _row;
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+    optional<sqlite::error> _error;
+#endif
+};
+
+template<class... Ts>
+row_range<Ts...> statement::rows()
+{
+    return row_range<Ts...>(*this);
+}
+
+class statement_cache;
+class busy_handler;
+struct statement_cache_entry;
+
+// A `statement` leased from the statement cache of a `database` (see `database::prepare_cached`).
+// On destruction the statement is reset, its bindings are cleared and it is returned to the cache. The lease must not
+// outlive the `database`.
+class cached_statement
+{
+public:
+    // `cached_statement` is move-only
+    cached_statement(const cached_statement&) = delete;
+    cached_statement(cached_statement&& y);
+    cached_statement& operator=(const cached_statement&) = delete;
+    cached_statement& operator=(cached_statement&& y);
+
+    // sqlite3_reset(), sqlite3_clear_bindings(), then return the statement to the cache.
+    ~cached_statement();
+
+    statement& operator*() const
+    {
+        return *_stmt;
+    }
+
+    statement* operator->() const
+    {
+        return _stmt;
+    }
+
+private:
+    friend class database;
+
+    // Lease an entry of the cache.
+    explicit cached_statement(statement_cache_entry* entry);
+    // Wrap a statement which could not be cached, it will be finalized on destruction.
+    explicit cached_statement(statement&& stmt);
+
+    statement_cache_entry* _entry = nullptr;
+    optional<statement> _uncached;
+    statement* _stmt = nullptr;
+};
+
+struct statement_cache_stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+};
+
+// Counters of sqlite3_db_status(), see the SQLITE_DBSTATUS_* constants. Memory sizes are in bytes.
+struct database_status {
+    // Lookaside slots in use, current and highwater.
+    int lookaside_used = 0;
+    int lookaside_used_highwater = 0;
+    // Lookaside allocations satisfied, and failed because of the size or because all slots were used.
+    int lookaside_hit = 0;
+    int lookaside_miss_size = 0;
+    int lookaside_miss_full = 0;
+    // Pager cache memory, `cache_used_shared` divides the shared caches evenly between the connections.
+    int cache_used = 0;
+    int cache_used_shared = 0;
+    // Memory used by the schemas and by the prepared statements.
+    int schema_used = 0;
+    int stmt_used = 0;
+    // Pager cache hits, misses, pages written and pages spilled mid-transaction.
+    int cache_hit = 0;
+    int cache_miss = 0;
+    int cache_write = 0;
+    int cache_spill = 0;
+    // Whether there are unresolved deferred foreign key constraints.
+    bool deferred_fks = false;
+};
+
+// Result of `database::wal_checkpoint_v2()`.
+struct wal_checkpoint_result {
+    // Frames in the WAL file, and frames of the WAL copied into the database. -1 if the database is not in WAL mode.
+    int log_frames = 0;
+    int checkpointed_frames = 0;
+    // SQLITE_BUSY: the checkpoint couldn't complete because of other readers or writers.
+    bool busy = false;
+};
+
+// Retries of `database::set_busy_policy()` when a lock is held by another connection: exponential backoff with random
+// jitter, until a deadline.
+struct busy_policy {
+    // Sleep before the first retry, doubled after each retry up to `max_delay`.
+    std::chrono::microseconds initial_delay = std::chrono::microseconds(100);
+    std::chrono::microseconds max_delay = std::chrono::milliseconds(20);
+    // Each sleep is shortened by a random fraction up to `jitter` (0 to 1), so the connections waiting for the same
+    // lock don't retry in lockstep.
+    double jitter = 0.5;
+    // How long a lock wait lasts, from the SQLITE_BUSY which starts it. Then the operation fails with SQLITE_BUSY. Like
+    // sqlite3_busy_timeout(), this bounds each lock wait, not the whole operation: a statement waiting for several
+    // locks in turn (e.g. a read lock, then the write lock at commit) can wait up to a multiple of it.
+    std::chrono::milliseconds timeout = std::chrono::milliseconds(5000);
+};
+
+// Counters of the busy handler installed by `database::set_busy_policy()`.
+struct busy_stats {
+    // Lock waits, i.e. calls of the busy handler with a retry count of zero. An operation can wait for several locks.
+    uint64_t events = 0;
+    // Sleeps before retrying.
+    uint64_t retries = 0;
+    // Lock waits which gave up at the deadline, failing their operation with SQLITE_BUSY.
+    uint64_t timeouts = 0;
+    // Time spent sleeping, in total and by the longest lock wait.
+    std::chrono::nanoseconds total_wait = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds max_wait = std::chrono::nanoseconds(0);
 };
 
 class database
@@ -410,12 +1543,270 @@ public:
     // sqlite3_prepare().
     expected<statement, current_error> prepare(string_like sql);
 
+    // sqlite3_prepare_v3().
+    expected<statement, current_error> prepare(string_like sql, unsigned int prep_flags);
+
+    // Statement cache:
+    //
+    // `prepare_cached()` returns a statement from a per-connection cache keyed by the SQL text. On a miss the
+    // statement is prepared with `sqlite3_prepare_v3(..., SQLITE_PREPARE_PERSISTENT, ...)`. When the cache is full the
+    // least recently used idle statement is finalized. If the same SQL text is already leased (nested use), a
+    // one-shot statement is prepared instead, which is finalized when the lease is destroyed.
+    //
+    // The cache is not thread-safe: use one `database` per thread.
+
+    expected<cached_statement, current_error> prepare_cached(string_like sql);
+
+    static constexpr size_t k_default_statement_cache_capacity = 16;
+
+    // Finalize least recently used idle statements to fit the new capacity. Zero disables caching.
+    void set_statement_cache_capacity(size_t capacity);
+
+    statement_cache_stats get_statement_cache_stats() const;
+
+    // Finalize all idle statements in the cache.
+    void clear_statement_cache();
+
+    // Install a metrics sink (or remove it with nullptr), it affects the statements prepared afterwards. The sink must
+    // outlive the database and its statements.
+    void set_metrics(metrics* m);
+
+    metrics* get_metrics() const
+    {
+        return _metrics;
+    }
+
+    // sqlite3_create_function_v2(): register `f` as the scalar SQL function `name`.
+    //
+    // The number and types of the arguments and the result type are deduced from the signature of `f`, which must be a
+    // function pointer or a callable with a single, non-template call operator. The arguments are decoded with
+    // `value_decoder` and the result is set with `function_result`; `void` results are NULL. A single
+    // `span<sqlite3_value* const>` parameter makes the function variadic. Exceptions are reported
+    // as SQL errors. The callable is moved to the heap and destroyed by SQLite when the function is replaced or the
+    // database is closed.
+    //
+    // `flags` is combined with SQLITE_UTF8, pass SQLITE_DETERMINISTIC (and SQLITE_INNOCUOUS if safe) for pure functions
+    // so they can be used in indexes on expressions and factored out of loops.
+    //
+    //     db.create_function("score", [](double x, optional<int64_t> weight) { ... }, SQLITE_DETERMINISTIC);
+    //
+    template<class F>
+    SQLITECPPTHIN_NODISCARD expected<void, error> create_function(string_like_zt name, F&& f, int flags = 0)
+    {
+        using callable_type = std::decay_t<F>;
+        return create_function_raw(
+          name,
+          callable_traits<callable_type>::arity,
+          flags,
+          new callable_type(std::forward<F>(f)),
+          [](sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+              invoke_function(ctx, *static_cast<callable_type*>(sqlite3_user_data(ctx)), argc, argv);
+          },
+          [](void* p) {
+              delete static_cast<callable_type*>(p);
+          }
+        );
+    }
+
+    // sqlite3_create_window_function(): register `State` as the aggregate SQL function `name`.
+    //
+    // `State` must be default-constructible with the members
+    //
+    //     void step(Args...);   // Add a row, the arguments are deduced like in `create_function()`.
+    //     R final();            // The result of the group, like the result of `create_function()`.
+    //
+    // and, to make it usable as an aggregate window function, both of
+    //
+    //     void inverse(Args...);  // Remove a row added by `step()`.
+    //     R value();              // The current result, without finishing the group.
+    //
+    // A state is constructed for each group at its first row and destroyed after `final()`. Without rows `final()` is
+    // called on a temporary state. Exceptions are reported as SQL errors.
+    //
+    //     struct sum_of_squares {
+    //         double sum = 0;
+    //         void step(double x) { sum += x * x; }
+    //         double final() { return sum; }
+    //     };
+    //     db.create_aggregate<sum_of_squares>("sum_of_squares", SQLITE_DETERMINISTIC);
+    //
+    template<class State>
+    SQLITECPPTHIN_NODISCARD expected<void, error> create_aggregate(string_like_zt name, int flags = 0)
+    {
+        using function_type = aggregate_function<State>;
+        if constexpr (function_type::is_window) {
+            return create_window_function_raw(
+              name,
+              function_type::step_traits::arity,
+              flags,
+              new function_type(),
+              &function_type::x_step,
+              &function_type::x_final,
+              &function_type::x_value,
+              &function_type::x_inverse,
+              &function_type::x_destroy
+            );
+        } else {
+            return create_window_function_raw(
+              name,
+              function_type::step_traits::arity,
+              flags,
+              new function_type(),
+              &function_type::x_step,
+              &function_type::x_final,
+              nullptr,
+              nullptr,
+              &function_type::x_destroy
+            );
+        }
+    }
+
+    // sqlite3_db_config(SQLITE_DBCONFIG_LOOKASIDE) with memory allocated by SQLite. Call it right after opening the
+    // database, it fails with SQLITE_BUSY while lookaside memory is in use. Check the hit and miss counts with
+    // `status()`.
+    SQLITECPPTHIN_NODISCARD expected<void, error> db_config_lookaside(int slot_size, int slot_count);
+
+    // sqlite3_db_config(SQLITE_DBCONFIG_LOOKASIDE) with a caller-owned, 8-byte aligned buffer of `buffer.size() /
+    // slot_size` slots, which must outlive the database.
+    SQLITECPPTHIN_NODISCARD expected<void, error> db_config_lookaside(span<byte> buffer, int slot_size);
+
+    // sqlite3_db_status() for all counters. If `reset` is true, the highwater marks and the lookaside and cache
+    // hit/miss/write/spill counters are reset.
+    database_status status(bool reset = false) const;
+
+    // sqlite3_wal_checkpoint_v2() with SQLITE_CHECKPOINT_PASSIVE, FULL, RESTART or TRUNCATE. SQLITE_BUSY is not an
+    // error, see `wal_checkpoint_result::busy`. A null `schema` checkpoints all the attached databases.
+    [[nodiscard]] expected<wal_checkpoint_result, current_error>
+    wal_checkpoint_v2(int mode, string_like_zt schema = "main");
+
+    // sqlite3_wal_autocheckpoint(): checkpoint on commit when the WAL has at least `frames` frames, zero or negative
+    // to disable. It replaces the hook of `sqlite3_wal_hook()`.
+    void wal_autocheckpoint(int frames);
+
+    // sqlite3_busy_handler() retrying with `policy` when a lock is held by another connection, instead of failing
+    // right away with SQLITE_BUSY. `nullopt` removes the handler. This replaces sqlite3_busy_timeout() (and vice
+    // versa).
+    //
+    // SQLite doesn't call the handler when waiting could deadlock, e.g. when a read transaction tries to write after
+    // another connection has written (SQLITE_BUSY_SNAPSHOT in WAL mode). Use `transaction_mode::immediate` for the
+    // transactions which will write.
+    void set_busy_policy(const optional<busy_policy>& policy);
+
+    // The counters of the busy handler, they are kept when the policy is changed or removed. If `reset` is true they
+    // are reset. Can be called from any thread.
+    busy_stats get_busy_stats(bool reset = false) const;
+
 private:
+    friend class interrupt_scope;
+
+    // The busy handler state, created on first use. It is installed only by `set_busy_policy()`.
+    busy_handler& get_busy_handler();
+
+    // sqlite3_create_function_v2() of a scalar function. `destroy(user_data)` is called on failure, too.
+    expected<void, error> create_function_raw(
+      string_like_zt name,
+      int num_args,
+      int flags,
+      void* user_data,
+      void (*func)(sqlite3_context*, int, sqlite3_value**),
+      void (*destroy)(void*)
+    );
+
+    // sqlite3_create_window_function(), an ordinary aggregate if `value` and `inverse` are null. `destroy(user_data)`
+    // is called on failure, too.
+    expected<void, error> create_window_function_raw(
+      string_like_zt name,
+      int num_args,
+      int flags,
+      void* user_data,
+      void (*step)(sqlite3_context*, int, sqlite3_value**),
+      void (*final)(sqlite3_context*),
+      void (*value)(sqlite3_context*),
+      void (*inverse)(sqlite3_context*, int, sqlite3_value**),
+      void (*destroy)(void*)
+    );
+
     sqlite3* _db;
+    std::unique_ptr<statement_cache> _statement_cache;
+    metrics* _metrics;
+    std::unique_ptr<busy_handler> _busy_handler;
 };
 
 expected<database, error> open(const string& filename, int flags);
 expected<database, error> open(const char* filename, int flags);
 expected<database, error> open(const fs::path& filename, int flags);
 
+enum class journal_mode {
+    delete_,
+    truncate,
+    persist,
+    memory,
+    wal,
+    off
+};
+
+enum class synchronous_mode {
+    off = 0,
+    normal = 1,
+    full = 2,
+    extra = 3
+};
+
+enum class temp_store_mode {
+    default_ = 0,
+    file = 1,
+    memory = 2
+};
+
+struct lookaside_config {
+    int slot_size = 1200;
+    int slot_count = 100;
+};
+
+// Settings applied by `open()` right after sqlite3_open_v2(), the unset ones are left at the SQLite defaults. If any of
+// them fails, the database is closed and `open()` returns the error.
+//
+// Note that some settings can't be changed on some databases, in that case SQLite silently keeps the old value. For
+// example in-memory databases always use `journal_mode::memory`, and `page_size` can be changed only before the
+// database is created or when not in WAL mode.
+struct open_options {
+    // Flags for sqlite3_open_v2().
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    // See `database::db_config_lookaside()`.
+    optional<lookaside_config> lookaside = {};
+    // PRAGMA page_size, applied before `journal`.
+    optional<int> page_size = {};
+    // PRAGMA journal_mode.
+    optional<journal_mode> journal = {};
+    // PRAGMA synchronous.
+    optional<synchronous_mode> synchronous = {};
+    // PRAGMA cache_size: number of pages if positive, KiB if negative.
+    optional<int64_t> cache_size = {};
+    // PRAGMA mmap_size, in bytes.
+    optional<int64_t> mmap_size = {};
+    // PRAGMA temp_store.
+    optional<temp_store_mode> temp_store = {};
+    // sqlite3_busy_timeout(), in milliseconds.
+    optional<int> busy_timeout_ms = {};
+    // See `database::set_busy_policy()`, replaces `busy_timeout_ms`.
+    optional<busy_policy> busy = {};
+    // Executed after the settings above.
+    string init_sql = {};
+
+    // Loading data into a new database which can be recreated from scratch if the load is interrupted: no fsync, the
+    // rollback journal in memory, large cache. A crash may corrupt the database.
+    static open_options bulk_load();
+
+    // Many short read-write transactions from multiple connections: WAL with synchronous = NORMAL (durable up to the
+    // last checkpoint on power loss, never corrupt), busy timeout, temporary tables in memory.
+    static open_options oltp_wal();
+
+    // Read-only access to an existing database: reads through mmap instead of copying into the page cache.
+    static open_options read_only_mmap();
+};
+
+expected<database, error> open(const string& filename, const open_options& options);
+expected<database, error> open(const char* filename, const open_options& options);
+expected<database, error> open(const fs::path& filename, const open_options& options);
+
 } // namespace sqlite
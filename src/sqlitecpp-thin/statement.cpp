@@ -1,8 +1,10 @@
 #include "sqlite3.hpp"
 
 #include "common.hpp"
+#include "metrics.hpp"
 
 #include <cassert>
+#include <chrono>
 #include <cmath>
 
 #define RETURN_UNEXPECTED_ON_ERROR(X)                      \
@@ -16,28 +18,31 @@
         RETURN_UNEXPECTED(current_error(rc, db));                            \
     }
 
-#define RETURN_UNEXPECTED_ON_ERROR_OR_NULLOPT_ON_NULL \
-    auto* db = db_handle();                           \
-    int rc = sqlite3_errcode(db);                     \
-    if (rc != SQLITE_OK && rc != SQLITE_ROW) {        \
-        RETURN_UNEXPECTED(current_error(rc, db));     \
-    }                                                 \
-    if (column_type(col) == datatype::null) {         \
-        return nullopt;                               \
+#define RETURN_UNEXPECTED_ON_ERROR_OR_NULLOPT_ON_NULL     \
+    auto* db = db_handle();                               \
+    int rc = sqlite3_errcode(db);                         \
+    if (rc != SQLITE_OK && rc != SQLITE_ROW) {            \
+        RETURN_UNEXPECTED(current_error(rc, db));         \
+    }                                                     \
+    if (sqlite3_column_type(_stmt, col) == SQLITE_NULL) { \
+        return nullopt;                                   \
     }
 
 namespace sqlite
 {
 
-statement::statement(sqlite3_stmt* stmt)
+statement::statement(sqlite3_stmt* stmt, statement_metrics* stmt_metrics)
     : _stmt(stmt)
+    , _metrics(stmt_metrics)
 {
 }
 
 statement::statement(statement&& y)
     : _stmt(y._stmt)
+    , _metrics(y._metrics)
 {
     y._stmt = nullptr;
+    y._metrics = nullptr;
 }
 
 statement::~statement()
@@ -49,6 +54,7 @@ statement& statement::operator=(statement&& y)
 {
     auto was_this = MOVE(*this);
     std::swap(_stmt, y._stmt);
+    std::swap(_metrics, y._metrics);
     return *this;
 }
 
@@ -57,9 +63,38 @@ sqlite3* statement::db_handle() const
     return sqlite3_db_handle(_stmt);
 }
 
-expected<step_result, current_error> statement::step()
+int statement::step_rc_with_metrics()
 {
+    // Counted at the end of the statement. sqlite3_changes() would be stale after DDL.
+    const bool readonly = sqlite3_stmt_readonly(_stmt);
+    const auto total_changes = readonly ? 0 : sqlite3_total_changes64(db_handle());
+    auto start = std::chrono::steady_clock::now();
     int rc = sqlite3_step(_stmt);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    const auto changes = readonly ? 0 : sqlite3_total_changes64(db_handle()) - total_changes;
+    _metrics->record_step(uint64_t(ns), rc, changes);
+    return rc;
+}
+
+statement_status statement::status(bool reset) const
+{
+    int r = reset ? 1 : 0;
+    return statement_status{
+      .fullscan_step = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, r),
+      .sort = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_SORT, r),
+      .autoindex = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_AUTOINDEX, r),
+      .vm_step = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_VM_STEP, r),
+      .reprepare = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_REPREPARE, r),
+      .run = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_RUN, r),
+      .filter_miss = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_FILTER_MISS, r),
+      .filter_hit = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_FILTER_HIT, r),
+      .memused = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_MEMUSED, 0)
+    };
+}
+
+expected<step_result, current_error> statement::step()
+{
+    int rc = step_rc();
     switch (rc) {
     case SQLITE_ROW:
         return step_result::row;
@@ -114,7 +149,7 @@ expected<int, current_error> statement::column_int(int col)
 
 expected<int64_t, current_error> statement::column_int64(int col)
 {
-    if (auto i = sqlite3_column_int(_stmt, col); i != 0) {
+    if (auto i = sqlite3_column_int64(_stmt, col); i != 0) {
         return i;
     }
     RETURN_UNEXPECTED_ON_SQLITE3_ERRCODE
@@ -159,7 +194,7 @@ expected<optional<int>, current_error> statement::column_int_opt(int col)
 
 expected<optional<int64_t>, current_error> statement::column_int64_opt(int col)
 {
-    if (auto i = sqlite3_column_int(_stmt, col); i != 0) {
+    if (auto i = sqlite3_column_int64(_stmt, col); i != 0) {
         return i;
     }
     RETURN_UNEXPECTED_ON_ERROR_OR_NULLOPT_ON_NULL
@@ -188,7 +223,7 @@ expected<datatype, current_error> statement::column_type(int col)
         assert(r == SQLITE_NULL); // sqlite3_column_type is not expected to return anything else.
         {
             auto* db = db_handle();
-            if (int rc = sqlite3_errcode(db)) {
+            if (int rc = sqlite3_errcode(db); rc != SQLITE_OK && rc != SQLITE_ROW) {
                 RETURN_UNEXPECTED(current_error(rc, db));
             }
         }
@@ -202,6 +237,12 @@ expected<void, current_error> statement::reset()
     RETURN_VOID;
 }
 
+expected<void, current_error> statement::clear_bindings()
+{
+    RETURN_UNEXPECTED_ON_ERROR(sqlite3_clear_bindings(_stmt))
+    RETURN_VOID;
+}
+
 expected<void, current_error> statement::bind_blob(int index, const void* ptr, int size, void (*deleter)(void*))
 {
     RETURN_UNEXPECTED_ON_ERROR(sqlite3_bind_blob(_stmt, index, ptr, size, deleter))
@@ -341,4 +382,29 @@ expected<void, current_error> statement::bind_zeroblob(int index, size_t size)
     RETURN_VOID;
 }
 
+expected<void, current_error> statement::bind_array(int index, span<const int64_t> values)
+{
+    return bind_array_pointer(index, values.data(), values.size(), SQLITE_INTEGER);
+}
+
+expected<void, current_error> statement::bind_array(int index, span<const double> values)
+{
+    return bind_array_pointer(index, values.data(), values.size(), SQLITE_FLOAT);
+}
+
+expected<void, current_error> statement::bind_array(int index, span<const string_view> values)
+{
+    return bind_array_pointer(index, values.data(), values.size(), SQLITE_TEXT);
+}
+
+expected<void, current_error> statement::bind_array_pointer(int index, const void* data, size_t size, int type)
+{
+    // sqlite3_bind_pointer() calls the destructor on failure, too.
+    auto* binding = new array_binding{.data = data, .size = size, .type = type};
+    RETURN_UNEXPECTED_ON_ERROR(sqlite3_bind_pointer(_stmt, index, binding, k_array_pointer_type, [](void* p) {
+        delete static_cast<array_binding*>(p);
+    }))
+    RETURN_VOID;
+}
+
 } // namespace sqlite
@@ -0,0 +1,123 @@
+#include "statement_cache.hpp"
+
+#include "common.hpp"
+
+#include <cassert>
+
+namespace sqlite
+{
+
+statement_cache::statement_cache(size_t capacity)
+    : _entries()
+    , _index()
+    , _stats{.capacity = capacity}
+{
+}
+
+statement_cache_entry* statement_cache::lease(string_view sql)
+{
+    auto it = _index.find(sql);
+    if (it == _index.end() || it->second->leased) {
+        ++_stats.misses;
+        return nullptr;
+    }
+    ++_stats.hits;
+    auto entry_it = it->second;
+    _entries.splice(_entries.begin(), _entries, entry_it);
+    entry_it->leased = true;
+    return &*entry_it;
+}
+
+statement_cache_entry* statement_cache::insert(string_view sql, statement& stmt)
+{
+    if (_stats.capacity == 0 || _index.contains(sql) || !shrink_to(_stats.capacity - 1)) {
+        return nullptr;
+    }
+    _entries.push_front(statement_cache_entry{.sql = string(sql), .stmt = MOVE(stmt), .leased = true});
+    _index.emplace(_entries.front().sql, _entries.begin());
+    _stats.size = _entries.size();
+    return &_entries.front();
+}
+
+void statement_cache::set_capacity(size_t capacity)
+{
+    _stats.capacity = capacity;
+    shrink_to(capacity);
+}
+
+void statement_cache::clear()
+{
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        if (it->leased) {
+            ++it;
+        } else {
+            _index.erase(it->sql);
+            it = _entries.erase(it);
+        }
+    }
+    _stats.size = _entries.size();
+}
+
+bool statement_cache::shrink_to(size_t max_size)
+{
+    auto it = _entries.end();
+    while (_entries.size() > max_size && it != _entries.begin()) {
+        --it;
+        if (!it->leased) {
+            _index.erase(it->sql);
+            it = _entries.erase(it);
+            ++_stats.evictions;
+        }
+    }
+    _stats.size = _entries.size();
+    return _entries.size() <= max_size;
+}
+
+cached_statement::cached_statement(statement_cache_entry* entry)
+    : _entry(entry)
+    , _uncached()
+    , _stmt(&entry->stmt)
+{
+}
+
+cached_statement::cached_statement(statement&& stmt)
+    : _entry(nullptr)
+    , _uncached(MOVE(stmt))
+    , _stmt(&*_uncached)
+{
+}
+
+cached_statement::cached_statement(cached_statement&& y)
+    : _entry(y._entry)
+    , _uncached(MOVE(y._uncached))
+    , _stmt(_entry ? y._stmt : (_uncached ? &*_uncached : nullptr))
+{
+    y._entry = nullptr;
+    y._uncached.reset();
+    y._stmt = nullptr;
+}
+
+cached_statement& cached_statement::operator=(cached_statement&& y)
+{
+    auto was_this = MOVE(*this);
+    _entry = y._entry;
+    _uncached = MOVE(y._uncached);
+    _stmt = _entry ? y._stmt : (_uncached ? &*_uncached : nullptr);
+    y._entry = nullptr;
+    y._uncached.reset();
+    y._stmt = nullptr;
+    return *this;
+}
+
+cached_statement::~cached_statement()
+{
+    if (_entry) {
+        assert(_entry->leased);
+        auto* stmt = _entry->stmt.handle();
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        _entry->leased = false;
+    }
+}
+
+} // namespace sqlite
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <list>
+#include <unordered_map>
+
+namespace sqlite
+{
+
+struct statement_cache_entry {
+    string sql;
+    statement stmt;
+    bool leased = false;
+};
+
+// LRU cache of prepared statements, owned by `database`. Entries which are leased (used by a `cached_statement`) are
+// never evicted.
+class statement_cache
+{
+public:
+    explicit statement_cache(size_t capacity);
+
+    // Return the idle entry for `sql` marked as leased and counts a hit, or return nullptr and count a miss.
+    statement_cache_entry* lease(string_view sql);
+
+    // Store `stmt` as a new, leased entry. Returns nullptr and leaves `stmt` untouched if `sql` is already in the cache
+    // (leased) or there's no room for it.
+    statement_cache_entry* insert(string_view sql, statement& stmt);
+
+    void set_capacity(size_t capacity);
+
+    const statement_cache_stats& stats() const
+    {
+        return _stats;
+    }
+
+    // Finalize all idle statements.
+    void clear();
+
+private:
+    struct string_hash {
+        using is_transparent = void;
+        size_t operator()(string_view sv) const
+        {
+            return std::hash<string_view>{}(sv);
+        }
+    };
+
+    using entry_list = std::list<statement_cache_entry>;
+
+    // Evict idle entries from the back of the list until there are at most `max_size` entries left. Returns false if
+    // it's not possible since the remaining entries are leased.
+    bool shrink_to(size_t max_size);
+
+    // Most recently used first.
+    entry_list _entries;
+    std::unordered_map<string, entry_list::iterator, string_hash, std::equal_to<>> _index;
+    statement_cache_stats _stats;
+};
+
+} // namespace sqlite
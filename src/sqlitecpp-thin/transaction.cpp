@@ -0,0 +1,164 @@
+#include "transaction.hpp"
+
+#include "common.hpp"
+
+namespace sqlite
+{
+
+namespace
+{
+constexpr const char* k_savepoint_sql = "SAVEPOINT sqlitecpp_thin_savepoint";
+constexpr const char* k_release_sql = "RELEASE sqlitecpp_thin_savepoint";
+constexpr const char* k_rollback_to_sql = "ROLLBACK TO sqlitecpp_thin_savepoint";
+
+// Run a statement returning no rows through the statement cache.
+expected<void, current_error> exec_cached(database& db, const char* sql)
+{
+    auto stmt = db.prepare_cached(sql);
+#if SQLITECPPTHIN_EXPECTED
+    if (!stmt) {
+        RETURN_UNEXPECTED(stmt.error());
+    }
+    RETURN_IF_UNEXPECTED((*stmt)->step_done_changes());
+#else
+    stmt->step_done_changes();
+#endif
+    RETURN_VOID;
+}
+
+expected<void, current_error> rollback_savepoint(database& db)
+{
+    // ROLLBACK TO leaves the savepoint on the stack.
+    RETURN_IF_UNEXPECTED(exec_cached(db, k_rollback_to_sql));
+    return exec_cached(db, k_release_sql);
+}
+} // namespace
+
+savepoint::savepoint(database& db)
+    : _db(&db)
+{
+}
+
+savepoint::savepoint(savepoint&& y)
+    : _db(std::exchange(y._db, nullptr))
+{
+}
+
+savepoint& savepoint::operator=(savepoint&& y)
+{
+    auto was_this = MOVE(*this);
+    std::swap(_db, y._db);
+    return *this;
+}
+
+savepoint::~savepoint()
+{
+    if (_db) {
+#if SQLITECPPTHIN_EXCEPTION
+        try {
+            rollback();
+        } catch (...) {
+        }
+#else
+        (void)rollback();
+#endif
+    }
+}
+
+expected<void, current_error> savepoint::release()
+{
+    RETURN_IF_UNEXPECTED(exec_cached(*_db, k_release_sql));
+    _db = nullptr;
+    RETURN_VOID;
+}
+
+expected<void, current_error> savepoint::rollback()
+{
+    // After some errors (SQLITE_FULL, SQLITE_IOERR, SQLITE_NOMEM...) SQLite rolls back the whole transaction by itself.
+    if (!sqlite3_get_autocommit(_db->handle())) {
+        RETURN_IF_UNEXPECTED(rollback_savepoint(*_db));
+    }
+    _db = nullptr;
+    RETURN_VOID;
+}
+
+transaction::transaction(database& db, bool nested)
+    : _db(&db)
+    , _nested(nested)
+{
+}
+
+transaction::transaction(transaction&& y)
+    : _db(std::exchange(y._db, nullptr))
+    , _nested(y._nested)
+{
+}
+
+transaction& transaction::operator=(transaction&& y)
+{
+    auto was_this = MOVE(*this);
+    std::swap(_db, y._db);
+    std::swap(_nested, y._nested);
+    return *this;
+}
+
+transaction::~transaction()
+{
+    if (_db) {
+#if SQLITECPPTHIN_EXCEPTION
+        try {
+            rollback();
+        } catch (...) {
+        }
+#else
+        (void)rollback();
+#endif
+    }
+}
+
+expected<void, current_error> transaction::commit()
+{
+    const char* sql = _nested ? k_release_sql : "COMMIT";
+    RETURN_IF_UNEXPECTED(exec_cached(*_db, sql));
+    _db = nullptr;
+    RETURN_VOID;
+}
+
+expected<void, current_error> transaction::rollback()
+{
+    // After some errors (SQLITE_FULL, SQLITE_IOERR, SQLITE_NOMEM...) SQLite rolls back the transaction by itself.
+    if (!sqlite3_get_autocommit(_db->handle())) {
+        RETURN_IF_UNEXPECTED(_nested ? rollback_savepoint(*_db) : exec_cached(*_db, "ROLLBACK"));
+    }
+    _db = nullptr;
+    RETURN_VOID;
+}
+
+expected<transaction, current_error> begin_transaction(database& db, transaction_mode mode)
+{
+    const bool nested = !sqlite3_get_autocommit(db.handle());
+    const char* sql = k_savepoint_sql;
+    if (!nested) {
+        switch (mode) {
+        case transaction_mode::deferred:
+            sql = "BEGIN DEFERRED";
+            break;
+        case transaction_mode::immediate:
+            sql = "BEGIN IMMEDIATE";
+            break;
+        case transaction_mode::exclusive:
+            sql = "BEGIN EXCLUSIVE";
+            break;
+        }
+    }
+    RETURN_IF_UNEXPECTED(exec_cached(db, sql));
+    return transaction(db, nested);
+}
+
+expected<savepoint, current_error> begin_savepoint(database& db)
+{
+    RETURN_IF_UNEXPECTED(exec_cached(db, k_savepoint_sql));
+    return savepoint(db);
+}
+
+} // namespace sqlite
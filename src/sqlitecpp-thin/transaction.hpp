@@ -0,0 +1,115 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+namespace sqlite
+{
+
+enum class transaction_mode {
+    // BEGIN DEFERRED: the locks are taken by the first read and the first write.
+    deferred,
+    // BEGIN IMMEDIATE: take the write lock at the start, so SQLITE_BUSY can't happen later in the transaction when a
+    // read lock would be upgraded.
+    immediate,
+    // BEGIN EXCLUSIVE: like `immediate`, and in rollback-journal modes also keep the other connections from reading.
+    exclusive
+};
+
+// A savepoint of a `database`, see `begin_savepoint()`.
+//
+// Rolled back (ROLLBACK TO and RELEASE) on destruction unless it was released. All the savepoints of this library,
+// including the nested `transaction`s, are named `sqlitecpp_thin_savepoint`, and RELEASE and ROLLBACK TO apply to the
+// innermost one: the savepoints must be finished in the reverse order they were started, which RAII scopes do
+// naturally.
+class savepoint
+{
+public:
+    explicit savepoint(database& db);
+
+    // `savepoint` is move-only
+    savepoint(const savepoint&) = delete;
+    savepoint(savepoint&& y);
+    savepoint& operator=(const savepoint&) = delete;
+    savepoint& operator=(savepoint&& y);
+
+    // `rollback()`, ignoring the errors.
+    ~savepoint();
+
+    // False after `release()` or `rollback()`.
+    bool is_active() const
+    {
+        return _db != nullptr;
+    }
+
+    // RELEASE: keep the changes made since the savepoint. If it's the outermost savepoint and there's no transaction,
+    // this commits. If it fails the savepoint stays active.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> release();
+
+    // ROLLBACK TO and RELEASE: undo the changes made since the savepoint. Nothing is done if SQLite has already rolled
+    // back the transaction after an error. If it fails the savepoint stays active.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> rollback();
+
+private:
+    database* _db;
+};
+
+// A transaction of a `database`, see `begin_transaction()`.
+//
+// Rolled back on destruction unless it was committed, so an exception or an early return on error undoes the
+// changes. When a transaction is already active on the connection, the `transaction` is a nested savepoint, named like
+// those of `savepoint`: `commit()` releases it and `rollback()` undoes only its changes.
+class transaction
+{
+public:
+    transaction(database& db, bool nested);
+
+    // `transaction` is move-only
+    transaction(const transaction&) = delete;
+    transaction(transaction&& y);
+    transaction& operator=(const transaction&) = delete;
+    transaction& operator=(transaction&& y);
+
+    // `rollback()`, ignoring the errors.
+    ~transaction();
+
+    // False after `commit()` or `rollback()`.
+    bool is_active() const
+    {
+        return _db != nullptr;
+    }
+
+    // True if it was started inside another transaction, as a savepoint.
+    bool is_nested() const
+    {
+        return _nested;
+    }
+
+    // COMMIT, or RELEASE if nested. If the commit fails (e.g. SQLITE_BUSY) the transaction stays active and can be
+    // committed again or rolled back.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> commit();
+
+    // ROLLBACK, or ROLLBACK TO and RELEASE if nested. Nothing is done if SQLite has already rolled back the
+    // transaction after an error. If it fails the transaction stays active.
+    SQLITECPPTHIN_NODISCARD expected<void, current_error> rollback();
+
+private:
+    database* _db;
+    bool _nested;
+};
+
+// BEGIN DEFERRED/IMMEDIATE/EXCLUSIVE, or SAVEPOINT if a transaction is already active (sqlite3_get_autocommit() is
+// false), in which case `mode` is ignored. The statements are run through `database::prepare_cached()`, so
+// they're parsed only once per connection.
+//
+//     auto tx = sqlite::begin_transaction(db, sqlite::transaction_mode::immediate).value();
+//     ... writes, returning on error ...
+//     return tx.commit();
+//
+expected<transaction, current_error>
+begin_transaction(database& db, transaction_mode mode = transaction_mode::deferred);
+
+// SAVEPOINT, through `database::prepare_cached()`. The savepoints of this library share the same name, a RELEASE or
+// ROLLBACK TO applies to the innermost one.
+expected<savepoint, current_error> begin_savepoint(database& db);
+
+} // namespace sqlite
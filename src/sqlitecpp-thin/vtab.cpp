@@ -0,0 +1,221 @@
+#include "vtab.hpp"
+
+#include "common.hpp"
+
+#include <cctype>
+
+namespace sqlite
+{
+
+namespace
+{
+constexpr int k_carray_pointer_column = 1;
+
+struct carray_cursor : sqlite3_vtab_cursor {
+    const array_binding* array;
+    size_t pos;
+};
+
+struct carray_vtab : sqlite3_vtab {
+    // A closed cursor kept for the next xOpen, to avoid an allocation per statement execution.
+    carray_cursor* spare_cursor;
+};
+
+int carray_connect(sqlite3* db, void*, int, const char* const*, sqlite3_vtab** out, char**)
+{
+    if (int rc = sqlite3_declare_vtab(db, "CREATE TABLE x(value, pointer HIDDEN)")) {
+        return rc;
+    }
+    sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+    *out = new (std::nothrow) carray_vtab{};
+    return *out ? SQLITE_OK : SQLITE_NOMEM;
+}
+
+int carray_disconnect(sqlite3_vtab* vt)
+{
+    delete static_cast<carray_vtab*>(vt)->spare_cursor;
+    delete static_cast<carray_vtab*>(vt);
+    return SQLITE_OK;
+}
+
+int carray_best_index(sqlite3_vtab*, sqlite3_index_info* info)
+{
+    for (int i = 0; i < info->nConstraint; ++i) {
+        const auto& c = info->aConstraint[i];
+        if (c.iColumn != k_carray_pointer_column || c.op != SQLITE_INDEX_CONSTRAINT_EQ) {
+            continue;
+        }
+        if (!c.usable) {
+            // Tell SQLite to find a plan in which the pointer argument is available.
+            return SQLITE_CONSTRAINT;
+        }
+        info->aConstraintUsage[i].argvIndex = 1;
+        info->aConstraintUsage[i].omit = 1;
+        info->idxNum = 1;
+        info->estimatedCost = 1;
+        info->estimatedRows = 100;
+        return SQLITE_OK;
+    }
+    // Without the argument the table is empty, make the plan unattractive.
+    info->idxNum = 0;
+    info->estimatedCost = 2147483647;
+    info->estimatedRows = 2147483647;
+    return SQLITE_OK;
+}
+
+int carray_open(sqlite3_vtab* vt, sqlite3_vtab_cursor** out)
+{
+    if (auto* c = std::exchange(static_cast<carray_vtab*>(vt)->spare_cursor, nullptr)) {
+        *c = carray_cursor{};
+        *out = c;
+        return SQLITE_OK;
+    }
+    *out = new (std::nothrow) carray_cursor{};
+    return *out ? SQLITE_OK : SQLITE_NOMEM;
+}
+
+int carray_close(sqlite3_vtab_cursor* cur)
+{
+    auto* vt = static_cast<carray_vtab*>(cur->pVtab);
+    if (!vt->spare_cursor) {
+        vt->spare_cursor = static_cast<carray_cursor*>(cur);
+        return SQLITE_OK;
+    }
+    delete static_cast<carray_cursor*>(cur);
+    return SQLITE_OK;
+}
+
+int carray_filter(sqlite3_vtab_cursor* cur, int idx_num, const char*, int, sqlite3_value** argv)
+{
+    auto& c = *static_cast<carray_cursor*>(cur);
+    c.array = idx_num ? static_cast<const array_binding*>(sqlite3_value_pointer(argv[0], k_array_pointer_type))
+                      : nullptr;
+    c.pos = 0;
+    return SQLITE_OK;
+}
+
+int carray_next(sqlite3_vtab_cursor* cur)
+{
+    ++static_cast<carray_cursor*>(cur)->pos;
+    return SQLITE_OK;
+}
+
+int carray_eof(sqlite3_vtab_cursor* cur)
+{
+    auto& c = *static_cast<carray_cursor*>(cur);
+    return !c.array || c.pos >= c.array->size;
+}
+
+int carray_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
+{
+    auto& c = *static_cast<carray_cursor*>(cur);
+    if (col == k_carray_pointer_column) {
+        sqlite3_result_null(ctx);
+        return SQLITE_OK;
+    }
+    switch (c.array->type) {
+    case SQLITE_INTEGER:
+        sqlite3_result_int64(ctx, static_cast<const int64_t*>(c.array->data)[c.pos]);
+        break;
+    case SQLITE_FLOAT:
+        sqlite3_result_double(ctx, static_cast<const double*>(c.array->data)[c.pos]);
+        break;
+    default: {
+        auto sv = static_cast<const string_view*>(c.array->data)[c.pos];
+        sqlite3_result_text64(ctx, sv.empty() ? "" : sv.data(), sv.size(), SQLITE_STATIC, SQLITE_UTF8);
+        break;
+    }
+    }
+    return SQLITE_OK;
+}
+
+int carray_rowid(sqlite3_vtab_cursor* cur, sqlite3_int64* rowid)
+{
+    *rowid = sqlite3_int64(static_cast<carray_cursor*>(cur)->pos) + 1;
+    return SQLITE_OK;
+}
+
+const sqlite3_module* carray_module()
+{
+    static const sqlite3_module module = [] {
+        sqlite3_module m{};
+        m.iVersion = 1;
+        // Eponymous-only: no xCreate.
+        m.xConnect = &carray_connect;
+        m.xBestIndex = &carray_best_index;
+        m.xDisconnect = &carray_disconnect;
+        m.xOpen = &carray_open;
+        m.xClose = &carray_close;
+        m.xFilter = &carray_filter;
+        m.xNext = &carray_next;
+        m.xEof = &carray_eof;
+        m.xColumn = &carray_column;
+        m.xRowid = &carray_rowid;
+        return m;
+    }();
+    return &module;
+}
+} // namespace
+
+column_affinity get_declared_affinity(string_view declaration)
+{
+    // The rules of sqlite3AffinityType(), applied to the words of the declared type: after the column name, before
+    // the constraints.
+    string type;
+    size_t pos = 0;
+    for (bool is_name = true;; is_name = false) {
+        pos = declaration.find_first_not_of(" \t\r\n", pos);
+        if (pos == string_view::npos) {
+            break;
+        }
+        size_t end = declaration.find_first_of(" \t\r\n", pos);
+        if (is_name && (declaration[pos] == '"' || declaration[pos] == '`' || declaration[pos] == '[')) {
+            const char quote = declaration[pos] == '[' ? ']' : declaration[pos];
+            end = declaration.find(quote, pos + 1);
+            end = end == string_view::npos ? end : end + 1;
+        }
+        string word(declaration.substr(pos, end == string_view::npos ? end : end - pos));
+        pos = end;
+        if (is_name) {
+            continue;
+        }
+        std::transform(word.begin(), word.end(), word.begin(), [](char c) {
+            return char(std::toupper(static_cast<unsigned char>(c)));
+        });
+        static constexpr string_view k_constraints[] = {
+          "CONSTRAINT", "PRIMARY", "NOT", "NULL", "UNIQUE", "CHECK", "DEFAULT", "COLLATE", "REFERENCES", "GENERATED",
+          "AS",
+        };
+        if (std::find(std::begin(k_constraints), std::end(k_constraints), word) != std::end(k_constraints)) {
+            break;
+        }
+        type += word;
+        type += ' ';
+    }
+    if (type.find("INT") != string::npos) {
+        return column_affinity::numeric;
+    }
+    if (type.find("CHAR") != string::npos || type.find("CLOB") != string::npos || type.find("TEXT") != string::npos) {
+        return column_affinity::text;
+    }
+    if (type.empty() || type.find("BLOB") != string::npos) {
+        return column_affinity::blob;
+    }
+    return column_affinity::numeric;
+}
+
+expected<void, error>
+create_module(database& db, string_like_zt name, const sqlite3_module* module, void* aux, void (*destroy)(void*))
+{
+    if (int rc = sqlite3_create_module_v2(db.handle(), name.c_str(), module, aux, destroy)) {
+        RETURN_UNEXPECTED(create_error_for_rc(rc, db.handle()));
+    }
+    RETURN_VOID;
+}
+
+expected<void, error> register_carray(database& db, string_like_zt name)
+{
+    return create_module(db, name, carray_module(), nullptr, nullptr);
+}
+
+} // namespace sqlite
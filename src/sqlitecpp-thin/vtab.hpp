@@ -0,0 +1,457 @@
+#pragma once
+
+#include "sqlite3.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace sqlite
+{
+
+// Affinity of a column, which converts the values compared with it, see https://sqlite.org/datatype3.html. The INTEGER
+// and REAL affinities compare like NUMERIC.
+enum class column_affinity { blob, text, numeric };
+
+// Affinity of a column definition like "id INTEGER", from its declared type.
+column_affinity get_declared_affinity(string_view declaration);
+
+// Three-way comparison of a column value of a `span_table` row with a constraint value, in the SQLite sort order: NULL,
+// numbers, text (BINARY collation), blobs. `affinity` is the column affinity whose conversions `compare()` applies to
+// the constraint value. Specialize it for user types if needed.
+template<class V>
+struct value_comparator;
+
+template<class V>
+    requires(std::is_arithmetic_v<V>)
+struct value_comparator<V> {
+    static constexpr column_affinity affinity = column_affinity::numeric;
+
+    static int compare(V x, sqlite3_value* v)
+    {
+        // Applies the numeric affinity of the column to text constraint values, like `id = '42'` on an INTEGER column.
+        switch (sqlite3_value_numeric_type(v)) {
+        case SQLITE_INTEGER:
+            if constexpr (std::is_integral_v<V>) {
+                auto y = sqlite3_value_int64(v);
+                return int64_t(x) < y ? -1 : int64_t(x) > y ? 1 : 0;
+            }
+            [[fallthrough]];
+        case SQLITE_FLOAT: {
+            auto y = sqlite3_value_double(v);
+            return double(x) < y ? -1 : double(x) > y ? 1 : 0;
+        }
+        case SQLITE_NULL:
+            return 1;
+        default:
+            return -1;
+        }
+    }
+};
+
+template<>
+struct value_comparator<string_view> {
+    static constexpr column_affinity affinity = column_affinity::text;
+
+    static int compare(string_view x, sqlite3_value* v)
+    {
+        switch (sqlite3_value_type(v)) {
+        case SQLITE_INTEGER:
+        case SQLITE_FLOAT:
+            // The text affinity compares numbers as text, like `name = 42`.
+        case SQLITE_TEXT: {
+            int c = x.compare(value_decoder<string_view>::decode(v));
+            return c < 0 ? -1 : c > 0 ? 1 : 0;
+        }
+        case SQLITE_BLOB:
+            return -1;
+        default:
+            return 1;
+        }
+    }
+};
+
+template<>
+struct value_comparator<string> : value_comparator<string_view> {};
+
+template<class V>
+struct value_comparator<optional<V>> {
+    static constexpr column_affinity affinity = value_comparator<V>::affinity;
+
+    static int compare(const optional<V>& x, sqlite3_value* v)
+    {
+        if (x) {
+            return value_comparator<V>::compare(*x, v);
+        }
+        return sqlite3_value_type(v) == SQLITE_NULL ? 0 : -1;
+    }
+};
+
+template<class T>
+struct span_table_column {
+    // Column definition of the CREATE TABLE statement, like "id INTEGER". The declared type sets the affinity.
+    string declaration;
+    // Set the value of the column of `row` as the result of `ctx`.
+    void (*result)(sqlite3_context* ctx, const T& row) = nullptr;
+    // Three-way comparison of the value of the column of `row` with `v`, needed only for the sorted key column.
+    int (*compare)(const T& row, sqlite3_value* v) = nullptr;
+    // The affinity `compare` implements. The key column is searched only if it's declared with this affinity.
+    column_affinity compare_affinity = column_affinity::blob;
+};
+
+// Column of a `span_table` reading the value with `std::invoke(Accessor, row)`: `Accessor` can be a pointer to data
+// member, a pointer to getter or a captureless lambda.
+//
+// The values are converted with `function_result`. Text and blobs returned by reference or as `string_view` or
+// `span<const byte>` are passed to SQLite as SQLITE_STATIC, without copying them first, so they must stay valid like
+// the rows.
+//
+//     sqlite::table_column<person, &person::id>("id INTEGER")
+//
+template<class T, auto Accessor>
+span_table_column<T> table_column(string declaration)
+{
+    using accessor_result = std::invoke_result_t<decltype(Accessor), const T&>;
+    using value_type = std::decay_t<accessor_result>;
+    span_table_column<T> column{
+      .declaration = std::move(declaration), .result = nullptr, .compare = nullptr, .compare_affinity = {}
+    };
+    column.result = [](sqlite3_context* ctx, const T& row) {
+        decltype(auto) x = std::invoke(Accessor, row);
+        constexpr bool is_stable = std::is_reference_v<accessor_result> || std::is_same_v<value_type, string_view>
+                                || std::is_same_v<value_type, span<const byte>>;
+        if constexpr (is_stable && std::is_convertible_v<const value_type&, string_view>) {
+            // Empty values are never NULL, even if `data() == nullptr`.
+            string_view s = x;
+            sqlite3_result_text64(ctx, s.empty() ? "" : s.data(), s.size(), SQLITE_STATIC, SQLITE_UTF8);
+        } else if constexpr (is_stable && std::is_convertible_v<const value_type&, span<const byte>>) {
+            static const byte k_byte{};
+            span<const byte> b = x;
+            sqlite3_result_blob64(ctx, b.empty() ? &k_byte : b.data(), b.size(), SQLITE_STATIC);
+        } else {
+            function_result<value_type>::set(ctx, x);
+        }
+    };
+    if constexpr (requires { value_comparator<value_type>::compare; }) {
+        column.compare = [](const T& row, sqlite3_value* v) {
+            return value_comparator<value_type>::compare(std::invoke(Accessor, row), v);
+        };
+        column.compare_affinity = value_comparator<value_type>::affinity;
+    }
+    return column;
+}
+
+template<class T>
+struct span_table {
+    // The rows, read in place. They must stay valid and unchanged while the table is registered.
+    span<const T> rows;
+    std::vector<span_table_column<T>> columns;
+    // Index of the column by which `rows` is sorted in ascending order, -1 if none. Equality and range constraints on
+    // it are evaluated with binary search, if they use the BINARY collation and the column is declared with the
+    // affinity of its comparator, and ORDER BY on it needs no sorting.
+    int sorted_key = -1;
+};
+
+// The sqlite3_module of `register_span_table()`.
+template<class T>
+class span_table_module
+{
+public:
+    static const sqlite3_module* get()
+    {
+        static const sqlite3_module module = [] {
+            sqlite3_module m{};
+            m.iVersion = 1;
+            // Same xCreate and xConnect: eponymous, and can be instantiated with CREATE VIRTUAL TABLE.
+            m.xCreate = &x_connect;
+            m.xConnect = &x_connect;
+            m.xBestIndex = &x_best_index;
+            m.xDisconnect = &x_disconnect;
+            m.xDestroy = &x_disconnect;
+            m.xOpen = &x_open;
+            m.xClose = &x_close;
+            m.xFilter = &x_filter;
+            m.xNext = &x_next;
+            m.xEof = &x_eof;
+            m.xColumn = &x_column;
+            m.xRowid = &x_rowid;
+            return m;
+        }();
+        return &module;
+    }
+
+    static void destroy_table(void* p)
+    {
+        delete static_cast<span_table<T>*>(p);
+    }
+
+private:
+    // Bits of idxNum, in the order of the argv of xFilter.
+    static constexpr int k_eq = 1;
+    static constexpr int k_gt = 2;
+    static constexpr int k_ge = 4;
+    static constexpr int k_lt = 8;
+    static constexpr int k_le = 16;
+
+    struct cursor : sqlite3_vtab_cursor {
+        size_t pos;
+        size_t end;
+    };
+
+    struct vtab : sqlite3_vtab {
+        const span_table<T>* table;
+        // Whether the comparator of the key column compares like SQLite.
+        bool searchable_key;
+        // A closed cursor kept for the next xOpen, to avoid an allocation per statement execution.
+        cursor* spare_cursor;
+    };
+
+    static const span_table<T>& get_table(sqlite3_vtab* vt)
+    {
+        return *static_cast<vtab*>(vt)->table;
+    }
+
+    static int x_connect(sqlite3* db, void* aux, int, const char* const*, sqlite3_vtab** out, char** errmsg)
+    {
+        try {
+            auto& table = *static_cast<const span_table<T>*>(aux);
+            string sql = "CREATE TABLE x(";
+            for (size_t i = 0; i < table.columns.size(); ++i) {
+                sql += i ? ", " : "";
+                sql += table.columns[i].declaration;
+            }
+            sql += ")";
+            if (int rc = sqlite3_declare_vtab(db, sql.c_str())) {
+                *errmsg = sqlite3_mprintf("%s", sqlite3_errmsg(db));
+                return rc;
+            }
+            sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+            auto* vt = new vtab{};
+            vt->table = &table;
+            if (table.sorted_key >= 0) {
+                const auto& key = table.columns[size_t(table.sorted_key)];
+                vt->searchable_key = get_declared_affinity(key.declaration) == key.compare_affinity;
+            }
+            *out = vt;
+            return SQLITE_OK;
+        } catch (const std::bad_alloc&) {
+            return SQLITE_NOMEM;
+        }
+    }
+
+    static int x_disconnect(sqlite3_vtab* vt)
+    {
+        delete static_cast<vtab*>(vt)->spare_cursor;
+        delete static_cast<vtab*>(vt);
+        return SQLITE_OK;
+    }
+
+    static int x_best_index(sqlite3_vtab* vt, sqlite3_index_info* info)
+    {
+        auto& table = get_table(vt);
+        const double num_rows = double(table.rows.size());
+        int eq = -1;
+        int lower = -1;
+        int upper = -1;
+        if (static_cast<vtab*>(vt)->searchable_key) {
+            for (int i = 0; i < info->nConstraint; ++i) {
+                const auto& c = info->aConstraint[i];
+                // The binary search would miss the rows equal in another collation, like NOCASE.
+                if (!c.usable || c.iColumn != table.sorted_key
+                    || sqlite3_stricmp(sqlite3_vtab_collation(info, i), "BINARY") != 0) {
+                    continue;
+                }
+                switch (c.op) {
+                case SQLITE_INDEX_CONSTRAINT_EQ:
+                    eq = eq < 0 ? i : eq;
+                    break;
+                case SQLITE_INDEX_CONSTRAINT_GT:
+                case SQLITE_INDEX_CONSTRAINT_GE:
+                    lower = lower < 0 ? i : lower;
+                    break;
+                case SQLITE_INDEX_CONSTRAINT_LT:
+                case SQLITE_INDEX_CONSTRAINT_LE:
+                    upper = upper < 0 ? i : upper;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        int num_args = 0;
+        auto use = [&](int i) {
+            info->aConstraintUsage[i].argvIndex = ++num_args;
+            // The binary search evaluates the constraint exactly.
+            info->aConstraintUsage[i].omit = 1;
+        };
+        info->idxNum = 0;
+        const double seek_cost = std::log2(num_rows + 1) + 1;
+        if (eq >= 0) {
+            use(eq);
+            info->idxNum = k_eq;
+            info->estimatedCost = seek_cost;
+            info->estimatedRows = 1;
+        } else if (lower >= 0 || upper >= 0) {
+            if (lower >= 0) {
+                use(lower);
+                info->idxNum |= info->aConstraint[lower].op == SQLITE_INDEX_CONSTRAINT_GT ? k_gt : k_ge;
+            }
+            if (upper >= 0) {
+                use(upper);
+                info->idxNum |= info->aConstraint[upper].op == SQLITE_INDEX_CONSTRAINT_LT ? k_lt : k_le;
+            }
+            const double fraction = lower >= 0 && upper >= 0 ? 0.0625 : 0.25;
+            info->estimatedCost = seek_cost + num_rows * fraction;
+            info->estimatedRows = sqlite3_int64(num_rows * fraction) + 1;
+        } else {
+            info->estimatedCost = num_rows + 1;
+            info->estimatedRows = sqlite3_int64(num_rows);
+        }
+        if (table.sorted_key >= 0 && info->nOrderBy == 1 && info->aOrderBy[0].iColumn == table.sorted_key
+            && !info->aOrderBy[0].desc) {
+            info->orderByConsumed = 1;
+        }
+        return SQLITE_OK;
+    }
+
+    static int x_open(sqlite3_vtab* vt, sqlite3_vtab_cursor** out)
+    {
+        if (auto* c = std::exchange(static_cast<vtab*>(vt)->spare_cursor, nullptr)) {
+            *c = cursor{};
+            *out = c;
+            return SQLITE_OK;
+        }
+        try {
+            *out = new cursor{};
+            return SQLITE_OK;
+        } catch (const std::bad_alloc&) {
+            return SQLITE_NOMEM;
+        }
+    }
+
+    static int x_close(sqlite3_vtab_cursor* cur)
+    {
+        auto* vt = static_cast<vtab*>(cur->pVtab);
+        if (!vt->spare_cursor) {
+            vt->spare_cursor = static_cast<cursor*>(cur);
+            return SQLITE_OK;
+        }
+        delete static_cast<cursor*>(cur);
+        return SQLITE_OK;
+    }
+
+    static int x_filter(sqlite3_vtab_cursor* cur, int idx_num, const char*, int argc, sqlite3_value** argv)
+    {
+        auto& c = *static_cast<cursor*>(cur);
+        auto& table = get_table(cur->pVtab);
+        auto rows = table.rows;
+        c.pos = 0;
+        c.end = rows.size();
+        if (idx_num == 0) {
+            return SQLITE_OK;
+        }
+
+        // Comparisons with NULL are never true.
+        for (int i = 0; i < argc; ++i) {
+            if (sqlite3_value_type(argv[i]) == SQLITE_NULL) {
+                c.end = 0;
+                return SQLITE_OK;
+            }
+        }
+        auto* compare = table.columns[size_t(table.sorted_key)].compare;
+        auto lower_bound = [&](sqlite3_value* v) {
+            return size_t(std::partition_point(rows.begin(), rows.end(), [&](const T& row) {
+                              return compare(row, v) < 0;
+                          })
+                          - rows.begin());
+        };
+        auto upper_bound = [&](sqlite3_value* v) {
+            return size_t(std::partition_point(rows.begin(), rows.end(), [&](const T& row) {
+                              return compare(row, v) <= 0;
+                          })
+                          - rows.begin());
+        };
+        int arg = 0;
+        if (idx_num & k_eq) {
+            c.pos = lower_bound(argv[arg]);
+            c.end = upper_bound(argv[arg]);
+            return SQLITE_OK;
+        }
+        if (idx_num & (k_gt | k_ge)) {
+            c.pos = idx_num & k_gt ? upper_bound(argv[arg]) : lower_bound(argv[arg]);
+            ++arg;
+        }
+        if (idx_num & (k_lt | k_le)) {
+            c.end = idx_num & k_lt ? lower_bound(argv[arg]) : upper_bound(argv[arg]);
+        }
+        c.end = std::max(c.pos, c.end);
+        return SQLITE_OK;
+    }
+
+    static int x_next(sqlite3_vtab_cursor* cur)
+    {
+        ++static_cast<cursor*>(cur)->pos;
+        return SQLITE_OK;
+    }
+
+    static int x_eof(sqlite3_vtab_cursor* cur)
+    {
+        auto& c = *static_cast<cursor*>(cur);
+        return c.pos >= c.end;
+    }
+
+    static int x_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
+    {
+        auto& c = *static_cast<cursor*>(cur);
+        auto& table = get_table(cur->pVtab);
+        table.columns[size_t(col)].result(ctx, table.rows[c.pos]);
+        return SQLITE_OK;
+    }
+
+    static int x_rowid(sqlite3_vtab_cursor* cur, sqlite3_int64* rowid)
+    {
+        *rowid = sqlite3_int64(static_cast<cursor*>(cur)->pos);
+        return SQLITE_OK;
+    }
+};
+
+// sqlite3_create_module_v2() for `module` with `aux`, `destroy(aux)` is called on failure, too.
+expected<void, error>
+create_module(database& db, string_like_zt name, const sqlite3_module* module, void* aux, void (*destroy)(void*));
+
+// Register `table` as the read-only virtual table module `name`, which is also available as the eponymous table
+// `name`:
+//
+//     SELECT * FROM people WHERE id BETWEEN 10 AND 20;
+//     CREATE VIRTUAL TABLE temp.staff USING people;
+//
+// The rows are read in place through the column accessors, without copying them into SQLite. If `sorted_key` is set,
+// the equality and range constraints on the key column seek by binary search instead of scanning.
+template<class T>
+SQLITECPPTHIN_NODISCARD expected<void, error>
+register_span_table(database& db, string_like_zt name, span_table<T> table)
+{
+    if (table.sorted_key >= 0) {
+        assert(size_t(table.sorted_key) < table.columns.size());
+        assert(table.columns[size_t(table.sorted_key)].compare);
+    }
+    return create_module(
+      db,
+      name,
+      span_table_module<T>::get(),
+      new span_table<T>(std::move(table)),
+      &span_table_module<T>::destroy_table
+    );
+}
+
+// Register the table-valued function `name(pointer)` which returns the values bound with `statement::bind_array()` in
+// its `value` column, in order. The `IN (?, ?, ..., ?)` lists with a varying number of parameters can be replaced by a
+// single statement:
+//
+//     SELECT * FROM t WHERE id IN carray(?1)
+//     SELECT t.* FROM carray(?1) AS ids JOIN t ON t.id = ids.value
+//
+expected<void, error> register_carray(database& db, string_like_zt name = "carray");
+
+} // namespace sqlite
@@ -0,0 +1,226 @@
+#include "write_queue.hpp"
+
+#include "common.hpp"
+
+#include <vector>
+
+namespace sqlite
+{
+
+namespace
+{
+// Call `f`, which returns `expected<void, current_error>`, and return its error instead of propagating it.
+template<class F>
+optional<error> catch_error(F&& f)
+{
+#if SQLITECPPTHIN_EXPECTED
+    if (auto r = f(); !r) {
+        return r.error().get_error();
+    }
+#else
+    try {
+        f();
+    } catch (const exception& e) {
+        return e.get_error();
+    }
+#endif
+    return nullopt;
+}
+
+// Return the error of `begin_transaction()`, or store the transaction in `tx`.
+optional<error> try_begin_transaction(database& db, transaction_mode mode, optional<transaction>& tx)
+{
+    return catch_error([&]() -> expected<void, current_error> {
+        auto r = begin_transaction(db, mode);
+#if SQLITECPPTHIN_EXPECTED
+        if (!r) {
+            RETURN_UNEXPECTED(r.error());
+        }
+        tx.emplace(MOVE(*r));
+#else
+        tx.emplace(MOVE(r));
+#endif
+        RETURN_VOID;
+    });
+}
+
+// The error which made SQLite roll back the transaction, if it's still on the database.
+error create_rolled_back_error(sqlite3* db)
+{
+    if (int rc = sqlite3_errcode(db); rc != SQLITE_OK) {
+        return current_error(rc, db).get_error();
+    }
+    return create_error_for_rc(SQLITE_ABORT);
+}
+
+optional<error> try_commit(transaction& tx)
+{
+    return catch_error([&] {
+        return tx.commit();
+    });
+}
+} // namespace
+
+write_queue::write_queue(database&& db, const write_queue_options& options)
+    : _db(MOVE(db))
+    , _options(options)
+    , _tail(&_stub)
+    , _stub()
+    , _head(&_stub)
+    , _num_jobs(0)
+    , _stop()
+    , _num_jobs_run(0)
+    , _num_jobs_failed(0)
+    , _num_batches(0)
+    , _writer()
+{
+    _writer = std::thread([this] {
+        writer();
+    });
+}
+
+write_queue::~write_queue()
+{
+    push(&_stop);
+    _writer.join();
+}
+
+write_queue_stats write_queue::get_stats() const
+{
+    return write_queue_stats{
+      .jobs = _num_jobs_run.load(std::memory_order_relaxed),
+      .failed_jobs = _num_jobs_failed.load(std::memory_order_relaxed),
+      .batches = _num_batches.load(std::memory_order_relaxed),
+    };
+}
+
+void write_queue::push(write_job* job)
+{
+    job->_next.store(nullptr, std::memory_order_relaxed);
+    write_job* prev = _head.exchange(job, std::memory_order_acq_rel);
+    prev->_next.store(job, std::memory_order_release);
+    _num_jobs.release();
+}
+
+write_job* write_queue::pop()
+{
+    // A job was counted by the semaphore, so it's in the queue. The loop waits only if a producer which came before it
+    // has not linked its job yet.
+    for (;;) {
+        write_job* tail = _tail;
+        write_job* next = tail->_next.load(std::memory_order_acquire);
+        if (tail == &_stub) {
+            if (!next) {
+                std::this_thread::yield();
+                continue;
+            }
+            _tail = next;
+            tail = next;
+            next = next->_next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            _tail = next;
+            return tail;
+        }
+        if (tail != _head.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+            continue;
+        }
+        // `tail` is the last job: put the stub behind it, so it can be unlinked.
+        push_stub();
+    }
+}
+
+void write_queue::push_stub()
+{
+    _stub._next.store(nullptr, std::memory_order_relaxed);
+    write_job* prev = _head.exchange(&_stub, std::memory_order_acq_rel);
+    prev->_next.store(&_stub, std::memory_order_release);
+}
+
+bool write_queue::run_job(write_job* job)
+{
+    _num_jobs_run.fetch_add(1, std::memory_order_relaxed);
+    // Nested in the batch transaction: a savepoint.
+    optional<transaction> sp;
+    if (auto e = try_begin_transaction(_db, transaction_mode::deferred, sp)) {
+        job->fail(*e);
+    } else if (job->run(_db)) {
+        if (auto release_error = try_commit(*sp)) {
+            job->fail(*release_error);
+        } else {
+            return true;
+        }
+    } else {
+        job->complete();
+    }
+    _num_jobs_failed.fetch_add(1, std::memory_order_relaxed);
+    // Rolls back the savepoint if it's still active.
+    sp.reset();
+    delete job;
+    return false;
+}
+
+void write_queue::writer()
+{
+    using clock = std::chrono::steady_clock;
+    std::vector<write_job*> batch;
+    for (bool stop = false; !stop;) {
+        _num_jobs.acquire();
+        write_job* first = pop();
+        if (first == &_stop) {
+            return;
+        }
+
+        optional<transaction> tx;
+        if (auto e = try_begin_transaction(_db, _options.mode, tx)) {
+            _num_jobs_run.fetch_add(1, std::memory_order_relaxed);
+            _num_jobs_failed.fetch_add(1, std::memory_order_relaxed);
+            first->fail(*e);
+            delete first;
+            continue;
+        }
+
+        batch.clear();
+        optional<error> batch_error;
+        const auto deadline = clock::now() + _options.max_batch_delay;
+        write_job* job = first;
+        for (size_t num_jobs = 1;; ++num_jobs) {
+            if (run_job(job)) {
+                batch.push_back(job);
+            }
+            // After some errors (SQLITE_FULL, SQLITE_IOERR, SQLITE_NOMEM...) SQLite rolls back the transaction by
+            // itself: the jobs of the batch are lost, and the next job must not run outside of the batch transaction.
+            if (sqlite3_get_autocommit(_db.handle())) {
+                batch_error = create_rolled_back_error(_db.handle());
+                break;
+            }
+            if (num_jobs >= _options.max_batch_size
+                || (!_num_jobs.try_acquire() && !_num_jobs.try_acquire_until(deadline))) {
+                break;
+            }
+            job = pop();
+            if (job == &_stop) {
+                stop = true;
+                break;
+            }
+        }
+
+        _num_batches.fetch_add(1, std::memory_order_relaxed);
+        if (!batch_error) {
+            batch_error = try_commit(*tx);
+        }
+        // Rolls back the transaction if the commit failed.
+        tx.reset();
+        for (auto* kept : batch) {
+            if (batch_error) {
+                kept->fail(*batch_error);
+            } else {
+                kept->complete();
+            }
+            delete kept;
+        }
+    }
+}
+
+} // namespace sqlite
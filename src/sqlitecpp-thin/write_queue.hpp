@@ -0,0 +1,313 @@
+#pragma once
+
+#include "sqlite3.hpp"
+#include "transaction.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <semaphore>
+#include <thread>
+#include <type_traits>
+
+namespace sqlite
+{
+
+struct write_queue_options {
+    // Maximum number of jobs committed in one transaction.
+    size_t max_batch_size = 1000;
+    // How long a batch stays open for more jobs after its first one. Zero commits the jobs which are already queued:
+    // the jobs submitted while the previous batch is committed are still grouped.
+    std::chrono::microseconds max_batch_delay = std::chrono::microseconds(0);
+    // Mode of the batch transactions.
+    transaction_mode mode = transaction_mode::immediate;
+};
+
+struct write_queue_stats {
+    // Jobs run, including the failed ones.
+    uint64_t jobs = 0;
+    // Jobs which returned an error or threw, their changes were rolled back.
+    uint64_t failed_jobs = 0;
+    // Transactions committed or failed.
+    uint64_t batches = 0;
+};
+
+// A job of the `write_queue`, linked into its multi-producer single-consumer queue.
+class write_job
+{
+public:
+    write_job()
+        : _next(nullptr)
+    {
+    }
+
+    write_job(const write_job&) = delete;
+    write_job& operator=(const write_job&) = delete;
+
+    virtual ~write_job() = default;
+
+    // Run the job on the writer thread and keep the result. Return false if it failed, its changes are rolled back.
+    virtual bool run(database& db) noexcept = 0;
+
+    // Complete the future with the kept result.
+    virtual void complete() noexcept = 0;
+
+    // Complete the future with `e` instead of the kept result, since the batch could not be committed.
+    virtual void fail(const error& e) noexcept = 0;
+
+private:
+    friend class write_queue;
+
+    std::atomic<write_job*> _next;
+};
+
+// Result of the futures of `write_queue`, like `async_result`:
+// - `expected<T, current_error>` and `T` results become `expected<T, error>`, which also reports the failed commit.
+// - Exceptions (the only way of error reporting in the exception-style lib) are rethrown by `future::get()`.
+template<class R>
+struct write_result {
+    using value_type = R;
+};
+
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+template<class T>
+struct write_result<std::expected<T, current_error>> {
+    using value_type = T;
+};
+#endif
+
+template<class R>
+using write_result_t = expected<typename write_result<R>::value_type, error>;
+
+// How `write_queue::submit_execute()` stores an argument in its job. The text views are copied into a `string`. The
+// blob views have no specialization and are rejected, pass a `std::vector<byte>` instead.
+template<class T>
+struct owned_argument {
+    using type = T;
+};
+
+template<>
+struct owned_argument<string_view> {
+    using type = string;
+};
+
+template<>
+struct owned_argument<const char*> {
+    using type = string;
+};
+
+template<>
+struct owned_argument<char*> {
+    using type = string;
+};
+
+template<class T>
+struct owned_argument<optional<T>> {
+    using type = optional<typename owned_argument<T>::type>;
+};
+
+template<class T, size_t N>
+struct owned_argument<span<T, N>>;
+
+template<class T>
+using owned_argument_t = typename owned_argument<std::decay_t<T>>::type;
+
+// `write_job` running `f(database&)`.
+template<class F>
+class function_write_job final : public write_job
+{
+public:
+    using raw_result_type = std::invoke_result_t<F&, database&>;
+    using value_type = typename write_result<raw_result_type>::value_type;
+    using result_type = write_result_t<raw_result_type>;
+
+    explicit function_write_job(F f)
+        : _f(std::move(f))
+        , _promise()
+        , _value()
+        , _error()
+        , _exception()
+    {
+    }
+
+    std::future<result_type> get_future()
+    {
+        return _promise.get_future();
+    }
+
+    bool run(database& db) noexcept override
+    {
+        try {
+            if constexpr (std::is_same_v<raw_result_type, value_type>) {
+                if constexpr (std::is_void_v<value_type>) {
+                    _f(db);
+                    _value.emplace();
+                } else {
+                    _value.emplace(_f(db));
+                }
+            } else {
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+                // expected<T, current_error>
+                auto r = _f(db);
+                if (!r) {
+                    _error.emplace(r.error().get_error());
+                    return false;
+                }
+                if constexpr (std::is_void_v<value_type>) {
+                    _value.emplace();
+                } else {
+                    _value.emplace(std::move(*r));
+                }
+#endif
+            }
+            return true;
+        } catch (...) {
+            _exception = std::current_exception();
+            return false;
+        }
+    }
+
+    void complete() noexcept override
+    {
+        if (_exception) {
+            _promise.set_exception(_exception);
+        } else if (_error) {
+            fail(*_error);
+        } else if constexpr (std::is_void_v<result_type>) {
+            _promise.set_value();
+        } else if constexpr (std::is_void_v<value_type>) {
+            _promise.set_value(result_type());
+        } else {
+            _promise.set_value(std::move(_value->x));
+        }
+    }
+
+    void fail([[maybe_unused]] const error& e) noexcept override
+    {
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+        _promise.set_value(std::unexpected(e));
+#else
+        _promise.set_exception(std::make_exception_ptr(exception(e)));
+#endif
+    }
+
+private:
+    struct empty {};
+    struct holder {
+        value_type x;
+    };
+    using storage_type = std::conditional_t<std::is_void_v<value_type>, empty, holder>;
+
+    F _f;
+    std::promise<result_type> _promise;
+    optional<storage_type> _value;
+    optional<error> _error;
+    std::exception_ptr _exception;
+};
+
+// Group commit: the single writer connection of a database, fed by any number of threads.
+//
+// The jobs are pushed to a lock-free queue and run one after the other on the writer thread, in one transaction per
+// batch. Each job runs in its own savepoint: a job which returns an error or throws is rolled back alone and its
+// future completes right away, the futures of the other jobs complete after the COMMIT. So a commit (and its fsync)
+// covers up to `max_batch_size` jobs instead of one. If an error makes SQLite roll back the whole transaction (e.g.
+// SQLITE_FULL or SQLITE_IOERR), the batch ends there and its previous jobs fail with that error.
+//
+//     sqlite::write_queue q(sqlite::open(path, sqlite::open_options::oltp_wal()).value());
+//     auto f = q.submit_execute("INSERT INTO events(kind, payload) VALUES(?, ?)", kind, std::move(payload));
+//     ... f.get() ...
+//
+// The jobs must not begin or end transactions themselves, the nested `begin_transaction()` calls are savepoints.
+class write_queue
+{
+public:
+    explicit write_queue(database&& db, const write_queue_options& options = {});
+
+    write_queue(const write_queue&) = delete;
+    write_queue& operator=(const write_queue&) = delete;
+
+    // Runs and commits the queued jobs, then stops the writer thread. No jobs can be submitted meanwhile.
+    ~write_queue();
+
+    // Queue `f(database&)`. The result is delivered through the future, see `write_result`.
+    template<class F>
+    std::future<typename function_write_job<std::decay_t<F>>::result_type> submit(F&& f)
+    {
+        auto* job = new function_write_job<std::decay_t<F>>(std::forward<F>(f));
+        auto future = job->get_future();
+        push(job);
+        return future;
+    }
+
+    // Queue `prepare_cached(sql)` and `execute(args...)` on the writer connection. The result is sqlite3_changes().
+    // The arguments are stored in the job, see `owned_argument`: text views are copied, blob views are rejected.
+    template<class... Args>
+        requires(requires { typename owned_argument_t<Args>; } && ...)
+    std::future<expected<int, error>> submit_execute(string sql, Args&&... args)
+    {
+        return submit(
+          [sql = std::move(sql), ... args = owned_argument_t<Args>(std::forward<Args>(args))](database& db) {
+              return execute_cached(db, sql, args...);
+          }
+        );
+    }
+
+    write_queue_stats get_stats() const;
+
+private:
+    template<class... Args>
+    static expected<int, current_error> execute_cached(database& db, const string& sql, const Args&... args)
+    {
+        auto stmt = db.prepare_cached(sql);
+#if defined SQLITECPPTHIN_EXPECTED && SQLITECPPTHIN_EXPECTED
+        if (!stmt) {
+            return std::unexpected(stmt.error());
+        }
+        return (*stmt)->execute(args...);
+#else
+        return stmt->execute(args...);
+#endif
+    }
+
+    // The sentinel job which stops the writer.
+    class stop_job final : public write_job
+    {
+    public:
+        bool run(database&) noexcept override
+        {
+            return true;
+        }
+        void complete() noexcept override {}
+        void fail(const error&) noexcept override {}
+    };
+
+    // Lock-free, called from any thread.
+    void push(write_job* job);
+    // Called from the writer thread after acquiring `_num_jobs`.
+    write_job* pop();
+    void push_stub();
+
+    void writer();
+    // Run `job` in a savepoint. Return true if it succeeded and waits for the commit.
+    bool run_job(write_job* job);
+
+    database _db;
+    write_queue_options _options;
+
+    // Intrusive MPSC queue (Vyukov): producers exchange `_head`, the writer pops from `_tail`. `_stub` keeps it
+    // non-empty.
+    write_job* _tail;
+    stop_job _stub;
+    std::atomic<write_job*> _head;
+    std::counting_semaphore<> _num_jobs;
+    stop_job _stop;
+
+    std::atomic<uint64_t> _num_jobs_run;
+    std::atomic<uint64_t> _num_jobs_failed;
+    std::atomic<uint64_t> _num_batches;
+
+    std::thread _writer;
+};
+
+} // namespace sqlite
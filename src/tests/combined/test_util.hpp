@@ -1,8 +1,55 @@
 #pragma once
 
+#include <atomic>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
 #define CHECK(COND)                                  \
     do {                                             \
         if (!(COND)) {                               \
             throw std::logic_error("CHECK failed."); \
         }                                            \
     } while (false)
+
+// A database file in the temp directory, named uniquely so that test binaries running concurrently don't collide. The
+// database, -wal and -shm files are removed on construction and destruction, declare it before the connections.
+class temp_database
+{
+public:
+    explicit temp_database(std::string_view name)
+        : path(unique_path(name))
+    {
+        remove();
+    }
+
+    temp_database(const temp_database&) = delete;
+    temp_database& operator=(const temp_database&) = delete;
+
+    ~temp_database()
+    {
+        remove();
+    }
+
+    const std::filesystem::path path;
+
+private:
+    static std::filesystem::path unique_path(std::string_view name)
+    {
+        static const auto process_id = std::random_device()();
+        static std::atomic<unsigned> counter = 0;
+        return std::filesystem::temp_directory_path()
+             / (std::string(name) + "-" + std::to_string(process_id) + "-" + std::to_string(counter++) + ".db");
+    }
+
+    void remove() const
+    {
+        std::error_code ec;
+        for (auto* suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(path.string() + suffix, ec);
+        }
+    }
+};
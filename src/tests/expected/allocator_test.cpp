@@ -0,0 +1,136 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/allocator.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+// Runs a small prepare/step workload, closes the database at the end.
+void run_workload()
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    CHECK(db.exec("CREATE TABLE foo (a INTEGER, b TEXT)"));
+    for (int i = 0; i < 100; ++i) {
+        auto stmt = db.prepare("INSERT INTO foo(a, b) VALUES(?, ?)").value();
+        const std::string text(size_t(i) * 10, 'x');
+        CHECK(stmt.execute(i, text));
+    }
+    auto stmt = db.prepare("SELECT count(1) FROM foo").value();
+    CHECK(stmt.step());
+    CHECK(stmt.column_int(0).value() == 100);
+}
+
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+    std::atomic<int64_t> num_allocations = 0;
+    std::atomic<int64_t> num_outstanding = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++num_allocations;
+        ++num_outstanding;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        --num_outstanding;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+} // namespace
+
+TEST(allocator, pool_allocator)
+{
+    ASSERT_TRUE(sqlite::install_pool_allocator());
+    run_workload();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back(run_workload);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    auto* p = sqlite3_malloc(100);
+    ASSERT_NE(p, nullptr);
+    EXPECT_GE(sqlite3_msize(p), 100);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 16, 0);
+    p = sqlite3_realloc(p, 100000);
+    ASSERT_NE(p, nullptr);
+    EXPECT_GE(sqlite3_msize(p), 100000);
+
+    auto s = sqlite::get_allocator_stats();
+    ASSERT_FALSE(s.size_classes.empty());
+    uint64_t num_allocations = 0;
+    for (size_t i = 0; i < s.size_classes.size(); ++i) {
+        if (i > 0) {
+            EXPECT_LT(s.size_classes[i - 1].block_size, s.size_classes[i].block_size);
+        }
+        num_allocations += s.size_classes[i].allocations;
+    }
+    EXPECT_GT(num_allocations, 0);
+    EXPECT_EQ(s.large.in_use, 1);
+    EXPECT_GE(s.current_bytes, 100000);
+    EXPECT_GE(s.peak_bytes, s.current_bytes);
+
+    // A sqlite3_shutdown() which doesn't replace the allocator keeps the blocks.
+    auto* small = static_cast<char*>(sqlite3_malloc(100));
+    ASSERT_NE(small, nullptr);
+    std::memset(small, 'x', 100);
+    ASSERT_EQ(sqlite3_shutdown(), SQLITE_OK);
+    ASSERT_EQ(sqlite3_initialize(), SQLITE_OK);
+    EXPECT_EQ(sqlite::get_allocator_stats().large.in_use, 1);
+    EXPECT_EQ(std::string_view(small, 100), std::string(100, 'x'));
+    sqlite3_free(small);
+
+    sqlite3_free(p);
+    EXPECT_EQ(sqlite::get_allocator_stats().large.in_use, 0);
+    ASSERT_TRUE(sqlite::restore_default_allocator());
+    run_workload();
+}
+
+TEST(allocator, memory_resource)
+{
+    counting_resource resource;
+    ASSERT_TRUE(sqlite::install_allocator(&resource));
+    run_workload();
+    EXPECT_GT(resource.num_allocations, 0);
+    EXPECT_EQ(uint64_t(resource.num_allocations), [] {
+        auto s = sqlite::get_allocator_stats();
+        uint64_t n = s.large.allocations;
+        for (auto& c : s.size_classes) {
+            n += c.allocations;
+        }
+        return n;
+    }());
+    ASSERT_TRUE(sqlite::restore_default_allocator());
+    EXPECT_EQ(resource.num_outstanding, 0);
+}
+
+TEST(allocator, config_pagecache_and_lookaside)
+{
+    ASSERT_TRUE(sqlite::config_pagecache(4096, 64));
+    ASSERT_TRUE(sqlite::config_lookaside(128, 20));
+    {
+        auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+        ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER, b TEXT)"));
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (1, 'one'), (2, 'two')"));
+        int current{}, highwater{};
+        ASSERT_EQ(sqlite3_status(SQLITE_STATUS_PAGECACHE_USED, &current, &highwater, 0), SQLITE_OK);
+        EXPECT_GT(current, 0);
+        EXPECT_LE(highwater, 64);
+    }
+    ASSERT_TRUE(sqlite::config_pagecache(0, 0));
+    ASSERT_TRUE(sqlite::config_lookaside(1200, 100));
+}
@@ -0,0 +1,87 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/async.hpp"
+
+#include <coroutine>
+#include <future>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+// Minimal eager coroutine type which signals completion through a `std::future`.
+struct test_coroutine {
+    struct promise_type {
+        promise_type()
+            : done()
+        {
+        }
+
+        std::promise<void> done;
+
+        test_coroutine get_return_object()
+        {
+            return test_coroutine{done.get_future()};
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void()
+        {
+            done.set_value();
+        }
+        void unhandled_exception()
+        {
+            done.set_exception(std::current_exception());
+        }
+    };
+
+    std::future<void> done;
+};
+
+test_coroutine insert_and_query(sqlite::async_database& adb, std::vector<std::tuple<int, std::string>>& result)
+{
+    auto r = co_await adb.async_exec("CREATE TABLE foo (a INTEGER, s TEXT)");
+    CHECK(r);
+    auto changes = co_await adb.async_exec_changes("INSERT INTO foo VALUES(1, 'one'), (2, 'two')");
+    CHECK(changes == 2);
+
+    auto insert = adb.get().prepare("INSERT INTO foo VALUES(3, 'three')").value();
+    changes = co_await adb.async_step_all(insert);
+    CHECK(changes == 1);
+
+    auto select = adb.get().prepare("SELECT a, s FROM foo ORDER BY a").value();
+    auto rows = co_await adb.async_fetch_all<int, std::string>(select);
+    CHECK(rows);
+    result = std::move(*rows);
+
+    auto bad = co_await adb.async_exec("SELECT * FROM nosuchtable");
+    CHECK(!bad && bad.error().errcode == SQLITE_ERROR);
+
+    auto n = co_await adb.run([](sqlite::database& db) {
+        return sqlite3_total_changes(db.handle());
+    });
+    CHECK(n == 3);
+}
+} // namespace
+
+TEST(async_database, exec_and_fetch)
+{
+    sqlite::executor ex(2);
+    sqlite::async_database adb(sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value(), ex);
+    std::vector<std::tuple<int, std::string>> result;
+    auto c = insert_and_query(adb, result);
+    c.done.get();
+    const std::vector<std::tuple<int, std::string>> expected_result = {
+      {1, "one"  },
+      {2, "two"  },
+      {3, "three"}
+    };
+    ASSERT_EQ(result, expected_result);
+}
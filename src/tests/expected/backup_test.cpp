@@ -0,0 +1,123 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/backup.hpp"
+
+namespace
+{
+sqlite::database open_source(int num_rows)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    CHECK(db.exec("CREATE TABLE foo (a INTEGER, b TEXT)"));
+    auto stmt = db.prepare("INSERT INTO foo(a, b) VALUES(?, ?)").value();
+    for (int i = 0; i < num_rows; ++i) {
+        CHECK(stmt.execute(i, "some text to fill the pages"));
+    }
+    return db;
+}
+
+int count_rows(sqlite::database& db)
+{
+    auto stmt = db.prepare("SELECT count(1) FROM foo").value();
+    CHECK(stmt.step());
+    return stmt.column_int(0).value();
+}
+} // namespace
+
+TEST(backup, step)
+{
+    auto source = open_source(1000);
+    auto dest = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+
+    auto b = sqlite::start_backup(dest, source).value();
+    ASSERT_EQ(b.step(1), false);
+    int pagecount = b.pagecount();
+    ASSERT_GT(pagecount, 2);
+    EXPECT_EQ(b.remaining(), pagecount - 1);
+    ASSERT_EQ(b.step(-1), true);
+    EXPECT_EQ(b.remaining(), 0);
+    ASSERT_TRUE(b.finish());
+    EXPECT_EQ(count_rows(dest), 1000);
+}
+
+TEST(backup, run_with_progress)
+{
+    auto source = open_source(1000);
+    auto dest = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+
+    auto b = sqlite::start_backup(dest, source).value();
+    std::vector<int> remaining;
+    auto completed = b.run({
+      .pages_per_step = 2,
+      .max_pages_per_second = 100000,
+      .progress =
+        [&](int r, int) {
+            remaining.push_back(r);
+            return true;
+        },
+    });
+    ASSERT_EQ(completed, true);
+    ASSERT_TRUE(b.finish());
+    ASSERT_GT(remaining.size(), 1);
+    EXPECT_TRUE(std::is_sorted(remaining.rbegin(), remaining.rend()));
+    EXPECT_EQ(remaining.back(), 0);
+    EXPECT_EQ(count_rows(dest), 1000);
+}
+
+TEST(backup, stopped_by_progress)
+{
+    auto source = open_source(1000);
+    auto dest = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+
+    auto b = sqlite::start_backup(dest, source).value();
+    auto completed = b.run({.pages_per_step = 1, .progress = [](int r, int pagecount) { return r > pagecount / 2; }});
+    ASSERT_EQ(completed, false);
+    EXPECT_GT(b.remaining(), 0);
+}
+
+TEST(backup, in_background)
+{
+    auto source = open_source(1000);
+    auto dest = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+
+    auto f = sqlite::run_backup_in_background(sqlite::start_backup(dest, source).value(), {.pages_per_step = 4});
+    auto r = f.get();
+    ASSERT_TRUE(r);
+    EXPECT_EQ(*r, true);
+    EXPECT_EQ(count_rows(dest), 1000);
+}
+
+TEST(backup, init_error)
+{
+    auto db = open_source(1);
+    // Source and destination must differ.
+    auto b = sqlite::start_backup(db, db);
+    ASSERT_FALSE(b);
+    EXPECT_EQ(b.error().errcode(), SQLITE_ERROR);
+}
+
+TEST(backup, busy_timeout)
+{
+    temp_database t("sqlitecpp-thin-backup-busy-test");
+    auto source = open_source(1000);
+    auto dest = sqlite::open(t.path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto locker = sqlite::open(t.path, SQLITE_OPEN_READWRITE).value();
+    ASSERT_TRUE(locker.exec("BEGIN EXCLUSIVE"));
+
+    auto b = sqlite::start_backup(dest, source).value();
+    auto completed = b.run({.busy_retry_interval = std::chrono::milliseconds(1),
+                            .max_busy_wait = std::chrono::milliseconds(20)});
+    ASSERT_FALSE(completed);
+    EXPECT_EQ(completed.error().errcode(), SQLITE_BUSY);
+
+    // The failed backup keeps reporting the error, without its handle.
+    EXPECT_EQ(b.handle(), nullptr);
+    EXPECT_EQ(b.remaining(), 0);
+    auto step = b.step(1);
+    ASSERT_FALSE(step);
+    EXPECT_EQ(step.error().errcode(), SQLITE_BUSY);
+    auto finished = b.finish();
+    ASSERT_FALSE(finished);
+    EXPECT_EQ(finished.error().errcode(), SQLITE_BUSY);
+
+    ASSERT_TRUE(locker.exec("COMMIT"));
+}
@@ -0,0 +1,80 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/blob.hpp"
+
+#include <numeric>
+
+TEST(blob, chunked_write_and_read)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.exec("CREATE TABLE assets (id INTEGER PRIMARY KEY, data BLOB)"));
+
+    std::vector<std::byte> source(10000);
+    std::iota(reinterpret_cast<uint8_t*>(source.data()), reinterpret_cast<uint8_t*>(source.data() + source.size()), 0);
+
+    auto insert = db.prepare("INSERT INTO assets(id, data) VALUES(?, ?)").value();
+    ASSERT_TRUE(insert.bind_int(1, 7));
+    ASSERT_TRUE(insert.bind_zeroblob(2, source.size()));
+    ASSERT_EQ(insert.step_done_changes(), 1);
+
+    auto writer = sqlite::open_blob(db, "assets", "data", 7, sqlite::blob_mode::read_write).value();
+    ASSERT_EQ(writer.size(), source.size());
+    constexpr size_t k_chunk_size = 4096;
+    for (size_t offset = 0; offset < source.size(); offset += k_chunk_size) {
+        auto chunk = std::span<const std::byte>(source).subspan(offset, std::min(k_chunk_size, source.size() - offset));
+        ASSERT_TRUE(writer.write(chunk, offset));
+    }
+    ASSERT_TRUE(writer.close());
+
+    auto reader = sqlite::open_blob(db, "assets", "data", 7).value();
+    std::vector<std::byte> result;
+    std::array<std::byte, 3000> buffer;
+    for (;;) {
+        auto n = reader.read_some(buffer, result.size()).value();
+        if (n == 0) {
+            break;
+        }
+        result.insert(result.end(), buffer.begin(), buffer.begin() + ptrdiff_t(n));
+    }
+    EXPECT_EQ(result, source);
+
+    // Reading past the end is an error.
+    auto r = reader.read(buffer, source.size() - 10);
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error().errcode(), SQLITE_ERROR);
+
+    // Read-only handle.
+    auto w = reader.write(std::span(buffer).first(1), 0);
+    ASSERT_FALSE(w);
+    EXPECT_EQ(w.error().errcode(), SQLITE_READONLY);
+}
+
+TEST(blob, reopen)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.exec("CREATE TABLE assets (id INTEGER PRIMARY KEY, data BLOB)"));
+    ASSERT_TRUE(db.exec("INSERT INTO assets VALUES (1, x'01'), (2, x'0202'), (3, x'030303')"));
+
+    auto blob = sqlite::open_blob(db, "assets", "data", 1).value();
+    for (int64_t id = 1; id <= 3; ++id) {
+        if (id > 1) {
+            ASSERT_TRUE(blob.reopen(id));
+        }
+        ASSERT_EQ(blob.size(), size_t(id));
+        std::byte b{};
+        ASSERT_TRUE(blob.read(std::span(&b, 1), 0));
+        EXPECT_EQ(b, std::byte(id));
+    }
+    auto r = blob.reopen(4);
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error().errcode(), SQLITE_ERROR);
+}
+
+TEST(blob, open_error)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.exec("CREATE TABLE assets (id INTEGER PRIMARY KEY, data BLOB)"));
+    auto blob = sqlite::open_blob(db, "assets", "no_such_column", 1);
+    ASSERT_FALSE(blob);
+    EXPECT_EQ(blob.error().errcode(), SQLITE_ERROR);
+}
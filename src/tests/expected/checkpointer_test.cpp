@@ -0,0 +1,156 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/checkpointer.hpp"
+
+#include <filesystem>
+#include <thread>
+
+namespace
+{
+uintmax_t wal_size(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path.string() + "-wal", ec);
+    return ec ? 0 : size;
+}
+} // namespace
+
+TEST(checkpointer, wal_checkpoint_v2)
+{
+    temp_database t("sqlitecpp-thin-wal-checkpoint-test");
+    auto db = sqlite::open(t.path, sqlite::open_options{.journal = sqlite::journal_mode::wal}).value();
+    db.wal_autocheckpoint(0);
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER)"));
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (1)"));
+    }
+    auto r = db.wal_checkpoint_v2(SQLITE_CHECKPOINT_PASSIVE).value();
+    EXPECT_GE(r.log_frames, 10);
+    EXPECT_EQ(r.checkpointed_frames, r.log_frames);
+    EXPECT_FALSE(r.busy);
+
+    r = db.wal_checkpoint_v2(SQLITE_CHECKPOINT_TRUNCATE).value();
+    EXPECT_EQ(r.log_frames, 0);
+    EXPECT_EQ(wal_size(t.path), 0u);
+
+    // A reader keeps RESTART from completing.
+    auto reader = sqlite::open(t.path, SQLITE_OPEN_READWRITE).value();
+    ASSERT_TRUE(reader.exec("BEGIN"));
+    ASSERT_TRUE(reader.exec("SELECT * FROM foo"));
+    ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (1)"));
+    r = db.wal_checkpoint_v2(SQLITE_CHECKPOINT_RESTART).value();
+    EXPECT_TRUE(r.busy);
+    ASSERT_TRUE(reader.exec("COMMIT"));
+
+    auto memory_db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    r = memory_db.wal_checkpoint_v2(SQLITE_CHECKPOINT_PASSIVE).value();
+    EXPECT_EQ(r.log_frames, -1);
+}
+
+TEST(checkpointer, background_checkpoints)
+{
+    using namespace std::chrono_literals;
+    temp_database t("sqlitecpp-thin-checkpointer-test");
+    // Waits for the RESTART checkpoints, which block the writers.
+    const sqlite::open_options options{.journal = sqlite::journal_mode::wal, .busy = sqlite::busy_policy{}};
+    auto writer = sqlite::open(t.path, options).value();
+    ASSERT_TRUE(writer.exec("CREATE TABLE foo (a INTEGER, b TEXT)"));
+
+    sqlite::checkpointer c(sqlite::open(t.path, SQLITE_OPEN_READWRITE).value(),
+                           sqlite::checkpointer_options{.checkpoint_frames = 20, .restart_frames = 100});
+    c.attach(writer);
+    auto stmt = writer.prepare("INSERT INTO foo VALUES (?, 'some text')").value();
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_TRUE(stmt.execute(i));
+    }
+    for (int i = 0; i < 500 && c.get_stats().frames_checkpointed < 400; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    auto stats = c.get_stats();
+    EXPECT_GE(stats.checkpoints, 1u);
+    EXPECT_GE(stats.frames_checkpointed, 400u);
+    EXPECT_EQ(stats.errors, 0u);
+    EXPECT_FALSE(stats.last_error);
+    EXPECT_GT(stats.total_time.count(), 0);
+    EXPECT_GE(stats.total_time, stats.max_time);
+
+    // Checkpoints on request.
+    ASSERT_TRUE(writer.exec("INSERT INTO foo VALUES (0, '')"));
+    const auto checkpoints = c.get_stats().checkpoints;
+    c.request_checkpoint();
+    for (int i = 0; i < 500 && c.get_stats().checkpoints == checkpoints; ++i) {
+        std::this_thread::sleep_for(10ms);
+    }
+    EXPECT_GT(c.get_stats().checkpoints, checkpoints);
+
+    // Once a checkpoint has copied the whole WAL, the next commit writes it from its start.
+    for (int i = 0; i < 500 && c.get_stats().wal_frames >= 10; ++i) {
+        ASSERT_TRUE(writer.exec("INSERT INTO foo VALUES (0, '')"));
+        c.request_checkpoint();
+        std::this_thread::sleep_for(10ms);
+    }
+    EXPECT_LT(c.get_stats().wal_frames, 10);
+
+    c.detach(writer);
+}
+
+TEST(checkpointer, restores_autocheckpoint)
+{
+    temp_database t("sqlitecpp-thin-checkpointer-autocheckpoint-test");
+    auto writer = sqlite::open(t.path, sqlite::open_options{.journal = sqlite::journal_mode::wal}).value();
+    writer.wal_autocheckpoint(500);
+    auto autocheckpoint = [&] {
+        auto stmt = writer.prepare("PRAGMA wal_autocheckpoint").value();
+        EXPECT_EQ(stmt.step(), sqlite::step_result::row);
+        return stmt.unchecked().column_int(0);
+    };
+
+    {
+        sqlite::checkpointer c(sqlite::open(t.path, SQLITE_OPEN_READWRITE).value());
+        c.attach(writer);
+        EXPECT_EQ(autocheckpoint(), 0);
+        c.detach(writer);
+        EXPECT_EQ(autocheckpoint(), 500);
+
+        writer.wal_autocheckpoint(300);
+        c.attach(writer);
+        // Attaching again keeps the autocheckpoint to restore.
+        c.attach(writer);
+        EXPECT_EQ(autocheckpoint(), 0);
+    }
+    EXPECT_EQ(autocheckpoint(), 300);
+
+    // A single detach is enough after attaching twice.
+    {
+        sqlite::checkpointer c(sqlite::open(t.path, SQLITE_OPEN_READWRITE).value());
+        c.attach(writer);
+        c.attach(writer);
+        c.detach(writer);
+        EXPECT_EQ(autocheckpoint(), 300);
+        writer.wal_autocheckpoint(200);
+    }
+    EXPECT_EQ(autocheckpoint(), 200);
+}
+
+TEST(checkpointer, interval_with_requests)
+{
+    temp_database t("sqlitecpp-thin-checkpointer-interval-test");
+    auto writer = sqlite::open(t.path, sqlite::open_options{.journal = sqlite::journal_mode::wal}).value();
+    ASSERT_TRUE(writer.exec("CREATE TABLE foo (a INTEGER)"));
+
+    sqlite::checkpointer c(sqlite::open(t.path, SQLITE_OPEN_READWRITE).value(),
+                           sqlite::checkpointer_options{.interval = std::chrono::milliseconds(1)});
+    c.attach(writer);
+    // Requests racing with the timed-out waits, then with the destructor.
+    std::thread requester([&] {
+        for (int i = 0; i < 10000; ++i) {
+            c.request_checkpoint();
+        }
+    });
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(writer.exec("INSERT INTO foo VALUES (1)"));
+    }
+    requester.join();
+    EXPECT_GE(c.get_stats().checkpoints, 1u);
+    EXPECT_EQ(c.get_stats().errors, 0u);
+}
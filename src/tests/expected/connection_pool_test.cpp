@@ -0,0 +1,76 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/connection_pool.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct temp_database_file : temp_database {
+    temp_database_file()
+        : temp_database("sqlitecpp-thin-connection-pool-test")
+    {
+        auto db = sqlite::open(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+        CHECK(db.exec("PRAGMA journal_mode = WAL"));
+        CHECK(db.exec("CREATE TABLE foo (a INTEGER)"));
+        CHECK(db.exec("INSERT INTO foo(a) VALUES(1), (2), (3)"));
+    }
+};
+} // namespace
+
+TEST(connection_pool, concurrent_readers)
+{
+    temp_database_file file;
+    auto options = sqlite::connection_pool_options{.size = 2, .open = sqlite::open_options::read_only_mmap()};
+    options.open.init_sql = "PRAGMA cache_size = -1024";
+    auto pool = sqlite::open_connection_pool(file.path, options).value();
+    ASSERT_EQ(pool.size(), 2);
+
+    std::atomic<int> num_failures = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&pool, &num_failures] {
+            for (int i = 0; i < 100; ++i) {
+                auto db = pool.acquire();
+                auto stmt = db->prepare_cached("SELECT sum(a) FROM foo");
+                if (!stmt || (*stmt)->step() != sqlite::step_result::row || (*stmt)->column_int(0) != 6) {
+                    ++num_failures;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(num_failures, 0);
+}
+
+TEST(connection_pool, try_acquire)
+{
+    temp_database_file file;
+    auto pool = sqlite::open_connection_pool(file.path, sqlite::connection_pool_options{.size = 2}).value();
+    auto c1 = pool.try_acquire();
+    auto c2 = pool.try_acquire();
+    ASSERT_TRUE(c1 && c2);
+    ASSERT_NE(&**c1, &**c2);
+    ASSERT_FALSE(pool.try_acquire());
+    c1.reset();
+    ASSERT_TRUE(pool.try_acquire());
+}
+
+TEST(connection_pool, open_failure)
+{
+    auto pool = sqlite::open_connection_pool("/nosuch/file/or/directory", sqlite::connection_pool_options{});
+    ASSERT_FALSE(pool);
+    ASSERT_EQ(pool.error().errcode, SQLITE_CANTOPEN);
+}
+
+TEST(connection_pool, empty)
+{
+    temp_database_file file;
+    auto pool = sqlite::open_connection_pool(file.path, sqlite::connection_pool_options{.size = 0});
+    ASSERT_FALSE(pool);
+    ASSERT_EQ(pool.error().errcode, SQLITE_MISUSE);
+}
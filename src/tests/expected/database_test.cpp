@@ -1,5 +1,8 @@
 #include "test_util.hpp"
 
+#include <latch>
+#include <thread>
+
 TEST(database, prepare_query_text_modes)
 {
     for (bool with_size : {false, true}) {
@@ -82,3 +85,290 @@ TEST(database, exec_changes)
 
     ASSERT_EQ(db.exec_changes("DELETE FROM foo WHERE a = 22"), 3);
 }
+
+TEST(database, status)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER)"));
+    auto stmt = db.prepare("SELECT a FROM foo").value();
+
+    auto s = db.status();
+    EXPECT_GT(s.schema_used, 0);
+    EXPECT_GT(s.stmt_used, 0);
+    EXPECT_GE(s.lookaside_used_highwater, s.lookaside_used);
+    EXPECT_FALSE(s.deferred_fks);
+
+    ASSERT_TRUE(db.exec("PRAGMA foreign_keys = ON"));
+    ASSERT_TRUE(db.exec("CREATE TABLE parent (id INTEGER PRIMARY KEY)"));
+    ASSERT_TRUE(db.exec("CREATE TABLE child (parent_id INTEGER REFERENCES parent(id) DEFERRABLE INITIALLY DEFERRED)"));
+    ASSERT_TRUE(db.exec("BEGIN"));
+    ASSERT_TRUE(db.exec("INSERT INTO child VALUES (1)"));
+    EXPECT_TRUE(db.status().deferred_fks);
+    ASSERT_TRUE(db.exec("ROLLBACK"));
+    EXPECT_FALSE(db.status().deferred_fks);
+}
+
+TEST(database, db_config_lookaside)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.db_config_lookaside(256, 50));
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER, b TEXT)"));
+    auto stmt = db.prepare("SELECT a, b FROM foo WHERE a > 1 ORDER BY b").value();
+    auto s = db.status();
+    EXPECT_GT(s.lookaside_hit, 0);
+    EXPECT_GT(s.lookaside_used, 0);
+
+    // Busy while lookaside memory is in use.
+    auto r = db.db_config_lookaside(512, 10);
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error().errcode, SQLITE_BUSY);
+
+    alignas(8) std::array<std::byte, 64 * 128> buffer;
+    auto db2 = sqlite::open(":memory:", sqlite::open_options{.lookaside = sqlite::lookaside_config{0, 0}}).value();
+    ASSERT_TRUE(db2.db_config_lookaside(buffer, 128));
+    ASSERT_TRUE(db2.exec("CREATE TABLE foo (a INTEGER, b TEXT)"));
+    EXPECT_GT(db2.status().lookaside_hit, 0);
+}
+
+namespace
+{
+int64_t add_int64(int64_t a, int64_t b)
+{
+    return a + b;
+}
+} // namespace
+
+TEST(database, create_function)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.create_function("add_int64", &add_int64, SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS));
+    std::string suffix = "!";
+    ASSERT_TRUE(db.create_function("shout", [suffix](std::string_view s) { return std::string(s) + suffix; }));
+    ASSERT_TRUE(db.create_function("or_default", [](std::optional<double> x) { return x.value_or(-1.0); }));
+    ASSERT_TRUE(db.create_function("always_null", [](int) -> std::optional<int> { return std::nullopt; }));
+    ASSERT_TRUE(db.create_function("num_args", [](std::span<sqlite3_value* const> args) { return int(args.size()); }));
+    ASSERT_TRUE(db.create_function("fail", [](int) -> int { throw std::runtime_error("no luck"); }));
+
+    const std::string query = "SELECT add_int64(5000000000, 2), shout('hi'), or_default(NULL), or_default(2.5), "
+                              "always_null(1), num_args(1, 2, 3)";
+    auto stmt = db.prepare(query).value();
+    ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+    auto row = stmt.unchecked();
+    EXPECT_EQ(row.column_int64(0), 5000000002);
+    EXPECT_EQ(row.column_text(1), "hi!");
+    EXPECT_EQ(row.column_double(2), -1.0);
+    EXPECT_EQ(row.column_double(3), 2.5);
+    EXPECT_EQ(row.column_int_opt(4), std::nullopt);
+    EXPECT_EQ(row.column_int(5), 3);
+
+    // Empty views are never NULL.
+    ASSERT_TRUE(db.create_function("empty_text", [] { return std::string_view(); }));
+    ASSERT_TRUE(db.create_function("empty_blob", [] { return std::span<const std::byte>(); }));
+    auto empty = db.prepare("SELECT typeof(empty_text()), empty_text() = '', typeof(empty_blob()), empty_blob() = x''")
+                   .value();
+    ASSERT_EQ(empty.step(), sqlite::step_result::row);
+    EXPECT_EQ(empty.unchecked().column_text(0), "text");
+    EXPECT_EQ(empty.unchecked().column_int(1), 1);
+    EXPECT_EQ(empty.unchecked().column_text(2), "blob");
+    EXPECT_EQ(empty.unchecked().column_int(3), 1);
+
+    // Wrong number of arguments.
+    EXPECT_FALSE(db.prepare("SELECT add_int64(1)"));
+
+    auto failing = db.prepare("SELECT fail(1)").value();
+    auto r = failing.step();
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error().errcode(), SQLITE_ERROR);
+    EXPECT_EQ(std::string_view(r.error().errmsg()), "no luck");
+
+    // Deterministic functions can be used in indexes on expressions.
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER)"));
+    ASSERT_TRUE(db.exec("CREATE INDEX foo_a ON foo(add_int64(a, 1))"));
+    EXPECT_FALSE(db.exec("CREATE INDEX foo_s ON foo(shout(a))"));
+}
+
+namespace
+{
+struct sum_of_squares {
+    double sum = 0;
+
+    void step(double x)
+    {
+        sum += x * x;
+    }
+    double final()
+    {
+        return sum;
+    }
+};
+
+// Sliding sum usable as a window function.
+struct window_sum {
+    int64_t sum = 0;
+
+    void step(int64_t x)
+    {
+        sum += x;
+    }
+    void inverse(int64_t x)
+    {
+        sum -= x;
+    }
+    int64_t value()
+    {
+        return sum;
+    }
+    int64_t final()
+    {
+        return sum;
+    }
+};
+
+// Too large for the aggregate context, allocated from the arena.
+struct last_values {
+    std::array<int64_t, 100> values = {};
+    size_t count = 0;
+    inline static int num_alive = 0;
+
+    last_values()
+    {
+        ++num_alive;
+    }
+    last_values(const last_values&) = delete;
+    last_values& operator=(const last_values&) = delete;
+    ~last_values()
+    {
+        --num_alive;
+    }
+
+    void step(int64_t x)
+    {
+        if (x < 0) {
+            throw std::invalid_argument("negative");
+        }
+        values[count++ % values.size()] = x;
+    }
+    std::optional<std::string> final()
+    {
+        if (count == 0) {
+            return std::nullopt;
+        }
+        return std::to_string(count) + ":" + std::to_string(values[(count - 1) % values.size()]);
+    }
+};
+} // namespace
+
+TEST(database, create_aggregate)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.create_aggregate<sum_of_squares>("sum_of_squares", SQLITE_DETERMINISTIC));
+    ASSERT_TRUE(db.create_aggregate<window_sum>("window_sum"));
+    ASSERT_TRUE(db.create_aggregate<last_values>("last_values"));
+    static_assert(sqlite::aggregate_function<sum_of_squares>::is_inline);
+    static_assert(!sqlite::aggregate_function<last_values>::is_inline);
+
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (g INTEGER, x INTEGER)"));
+    auto insert = db.prepare("INSERT INTO foo(g, x) VALUES(?, ?)").value();
+    for (int i = 1; i <= 1000; ++i) {
+        ASSERT_TRUE(insert.execute(i % 10, i));
+    }
+
+    auto grouped = db.prepare("SELECT g, sum_of_squares(x), last_values(x) FROM foo GROUP BY g ORDER BY g").value();
+    int num_groups = 0;
+    for (;;) {
+        auto r = grouped.step();
+        ASSERT_TRUE(r);
+        if (*r == sqlite::step_result::done) {
+            break;
+        }
+        auto row = grouped.unchecked();
+        const int64_t g = row.column_int64(0);
+        double expected_sum = 0;
+        for (int64_t x = g == 0 ? 10 : g; x <= 1000; x += 10) {
+            expected_sum += double(x * x);
+        }
+        EXPECT_EQ(row.column_double(1), expected_sum);
+        EXPECT_EQ(row.column_text(2), "100:" + std::to_string(g == 0 ? 1000 : 990 + g));
+        ++num_groups;
+    }
+    EXPECT_EQ(num_groups, 10);
+    EXPECT_EQ(last_values::num_alive, 0);
+
+    // No rows.
+    auto empty = db.prepare("SELECT sum_of_squares(x), last_values(x) FROM foo WHERE x < 0").value();
+    ASSERT_EQ(empty.step(), sqlite::step_result::row);
+    EXPECT_EQ(empty.unchecked().column_double(0), 0.0);
+    EXPECT_EQ(empty.unchecked().column_text_opt(1), std::nullopt);
+
+    const std::string window_query = "SELECT window_sum(x) OVER (ORDER BY x ROWS BETWEEN 2 PRECEDING AND CURRENT ROW) "
+                                     "FROM foo WHERE x <= 5 ORDER BY x";
+    auto window = db.prepare(window_query).value();
+    for (int64_t expected : {1, 3, 6, 9, 12}) {
+        ASSERT_EQ(window.step(), sqlite::step_result::row);
+        EXPECT_EQ(window.unchecked().column_int64(0), expected);
+    }
+    ASSERT_EQ(window.step(), sqlite::step_result::done);
+
+    // Window functions need `inverse()` and `value()`.
+    EXPECT_FALSE(db.prepare("SELECT sum_of_squares(x) OVER (ORDER BY x) FROM foo"));
+
+    ASSERT_TRUE(db.exec("INSERT INTO foo(g, x) VALUES(3, -1)"));
+    auto failing = db.prepare("SELECT last_values(x) FROM foo GROUP BY g").value();
+    sqlite::expected<sqlite::step_result, sqlite::current_error> r;
+    while ((r = failing.step()) && *r == sqlite::step_result::row) {
+    }
+    ASSERT_FALSE(r);
+    EXPECT_EQ(std::string_view(r.error().errmsg()), "negative");
+    // The states of the interrupted groups are destroyed with the reset.
+    EXPECT_FALSE(failing.reset());
+    EXPECT_EQ(last_values::num_alive, 0);
+}
+
+TEST(database, busy_policy)
+{
+    using namespace std::chrono_literals;
+    temp_database t("sqlitecpp-thin-busy-test");
+    auto db1 = sqlite::open(t.path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    const sqlite::busy_policy policy{.initial_delay = 100us, .max_delay = 2ms, .timeout = 50ms};
+    auto db2 = sqlite::open(t.path, sqlite::open_options{.busy = policy}).value();
+    ASSERT_TRUE(db1.exec("CREATE TABLE foo (a INTEGER)"));
+    EXPECT_EQ(db2.get_busy_stats().events, 0u);
+
+    // Gives up at the deadline.
+    ASSERT_TRUE(db1.exec("BEGIN IMMEDIATE"));
+    auto r = db2.exec("BEGIN IMMEDIATE");
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error().get_error().errcode, SQLITE_BUSY);
+    auto stats = db2.get_busy_stats();
+    EXPECT_GT(stats.retries, 0u);
+    EXPECT_GT(stats.total_wait.count(), 0);
+    EXPECT_EQ(stats.timeouts, 1u);
+
+    // Waits until the lock is released, after db2 started retrying.
+    db2.set_busy_policy(sqlite::busy_policy{.max_delay = 2ms, .timeout = 5000ms});
+    std::latch waiting(1);
+    std::thread releaser([&] {
+        waiting.wait();
+        while (db2.get_busy_stats().retries == stats.retries) {
+            std::this_thread::yield();
+        }
+        CHECK(db1.exec("COMMIT"));
+    });
+    waiting.count_down();
+    r = db2.exec("BEGIN IMMEDIATE");
+    releaser.join();
+    ASSERT_TRUE(r);
+    ASSERT_TRUE(db2.exec("COMMIT"));
+    const auto waited = db2.get_busy_stats(true);
+    EXPECT_GT(waited.retries, stats.retries);
+    EXPECT_GT(waited.total_wait, stats.total_wait);
+    EXPECT_EQ(waited.timeouts, 1u);
+    EXPECT_EQ(db2.get_busy_stats().events, 0u);
+
+    // Without the handler SQLITE_BUSY is returned right away.
+    db2.set_busy_policy(std::nullopt);
+    ASSERT_TRUE(db1.exec("BEGIN IMMEDIATE"));
+    ASSERT_FALSE(db2.exec("BEGIN IMMEDIATE"));
+    ASSERT_TRUE(db1.exec("COMMIT"));
+    EXPECT_EQ(db2.get_busy_stats().events, 0u);
+}
@@ -0,0 +1,121 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/interrupt.hpp"
+
+#include <thread>
+
+namespace
+{
+// Never returns a row.
+constexpr const char* k_endless_sql = "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c) "
+                                      "SELECT count(1) FROM c";
+} // namespace
+
+TEST(interrupt, deadline)
+{
+    using namespace std::chrono_literals;
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto stmt = db.prepare(k_endless_sql).value();
+    {
+        sqlite::interrupt_scope scope(db, 50ms);
+        const auto t0 = std::chrono::steady_clock::now();
+        auto r = stmt.step();
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error().errcode(), SQLITE_INTERRUPT);
+        EXPECT_GE(std::chrono::steady_clock::now() - t0, 50ms);
+        EXPECT_TRUE(scope.timed_out());
+        EXPECT_FALSE(scope.cancelled());
+        EXPECT_TRUE(scope.interrupted());
+    }
+
+    // Like sqlite3_reset(), which returns the error of the last step.
+    EXPECT_FALSE(stmt.reset());
+
+    // Statements within the deadline are not affected.
+    auto quick = db.prepare("SELECT 42").value();
+    {
+        sqlite::interrupt_scope scope(db, sqlite::interrupt_options{
+                                            .deadline = std::chrono::steady_clock::now() + 10s,
+                                            .progress_steps = 1,
+                                          });
+        EXPECT_EQ(quick.step().value(), sqlite::step_result::row);
+        EXPECT_EQ(quick.column_int(0).value(), 42);
+        EXPECT_FALSE(scope.interrupted());
+    }
+}
+
+TEST(interrupt, stop_token)
+{
+    using namespace std::chrono_literals;
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto stmt = db.prepare(k_endless_sql).value();
+    {
+        std::stop_source source;
+        sqlite::interrupt_scope scope(db, source.get_token());
+        std::thread canceller([&source] {
+            std::this_thread::sleep_for(20ms);
+            source.request_stop();
+        });
+        auto r = stmt.step();
+        canceller.join();
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error().errcode(), SQLITE_INTERRUPT);
+        EXPECT_TRUE(scope.cancelled());
+        EXPECT_FALSE(scope.timed_out());
+    }
+    EXPECT_FALSE(stmt.reset());
+
+    // A stop requested before the scope.
+    {
+        std::stop_source source;
+        source.request_stop();
+        sqlite::interrupt_scope scope(db, source.get_token());
+        EXPECT_TRUE(scope.cancelled());
+        EXPECT_FALSE(stmt.step());
+    }
+    EXPECT_FALSE(stmt.reset());
+
+    // The progress handler is removed with the scope.
+    EXPECT_EQ(db.prepare("SELECT count(1) FROM (SELECT 1 UNION ALL SELECT 2)").value().step().value(),
+              sqlite::step_result::row);
+}
+
+TEST(interrupt, busy_wait)
+{
+    using namespace std::chrono_literals;
+    temp_database t("sqlitecpp-thin-interrupt-busy-test");
+    auto db1 = sqlite::open(t.path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    const sqlite::busy_policy policy{.max_delay = 2ms, .timeout = 5000ms};
+    auto db2 = sqlite::open(t.path, sqlite::open_options{.busy = policy}).value();
+    ASSERT_TRUE(db1.exec("BEGIN IMMEDIATE"));
+
+    // The deadline ends the lock wait long before the timeout of the policy.
+    {
+        sqlite::interrupt_scope scope(db2, 50ms);
+        const auto t0 = std::chrono::steady_clock::now();
+        auto r = db2.exec("BEGIN IMMEDIATE");
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error().get_error().errcode, SQLITE_BUSY);
+        EXPECT_LT(std::chrono::steady_clock::now() - t0, 2000ms);
+        EXPECT_TRUE(scope.timed_out());
+    }
+    EXPECT_EQ(db2.get_busy_stats().timeouts, 0u);
+
+    // So does a stop request.
+    {
+        std::stop_source source;
+        sqlite::interrupt_scope scope(db2, source.get_token());
+        std::thread canceller([&] {
+            while (db2.get_busy_stats().retries == 0) {
+                std::this_thread::yield();
+            }
+            source.request_stop();
+        });
+        auto r = db2.exec("BEGIN IMMEDIATE");
+        canceller.join();
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error().get_error().errcode, SQLITE_BUSY);
+        EXPECT_TRUE(scope.cancelled());
+    }
+    ASSERT_TRUE(db1.exec("COMMIT"));
+}
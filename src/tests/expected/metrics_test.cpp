@@ -0,0 +1,118 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/metrics.hpp"
+
+#include <thread>
+
+TEST(metrics, records_prepare_step_rows_changes)
+{
+    sqlite::metrics m;
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    db.set_metrics(&m);
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER)"));
+
+    {
+        auto stmt = db.prepare("INSERT INTO foo(a) VALUES(?)").value();
+        for (int i = 0; i < 3; ++i) {
+            ASSERT_EQ(stmt.execute(i), 1);
+        }
+    }
+    for (int i = 0; i < 2; ++i) {
+        auto stmt = db.prepare_cached("SELECT a FROM foo").value();
+        int count = 0;
+        for ([[maybe_unused]] auto [a] : stmt->rows<int>()) {
+            ++count;
+        }
+        ASSERT_EQ(count, 3);
+    }
+
+    auto s = m.snapshot();
+    ASSERT_EQ(s.size(), 2);
+    // Ordered by SQL text.
+    EXPECT_EQ(s[0].sql, "INSERT INTO foo(a) VALUES(?)");
+    EXPECT_EQ(s[0].prepare.count, 1);
+    EXPECT_EQ(s[0].step.count, 3);
+    EXPECT_EQ(s[0].rows, 0);
+    EXPECT_EQ(s[0].changes, 3);
+
+    EXPECT_EQ(s[1].sql, "SELECT a FROM foo");
+    // The second lease is a cache hit.
+    EXPECT_EQ(s[1].prepare.count, 1);
+    EXPECT_EQ(s[1].step.count, 8);
+    EXPECT_EQ(s[1].rows, 6);
+    EXPECT_EQ(s[1].changes, 0);
+    EXPECT_LE(s[1].step.quantile_ns(0.5), s[1].step.quantile_ns(1.0));
+    EXPECT_GE(s[1].step.quantile_ns(1.0) * s[1].step.count, s[1].step.sum_ns);
+}
+
+TEST(metrics, changes_of_ddl_and_returning)
+{
+    sqlite::metrics m;
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    db.set_metrics(&m);
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER)"));
+    ASSERT_EQ(db.prepare("INSERT INTO foo(a) VALUES (1), (2)").value().execute(), 2);
+    // sqlite3_changes() still returns 2 after DDL.
+    ASSERT_EQ(db.prepare("CREATE TABLE bar (b INTEGER)").value().step(), sqlite::step_result::done);
+    {
+        auto stmt = db.prepare("DELETE FROM foo RETURNING a").value();
+        ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+        ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+        ASSERT_EQ(stmt.step(), sqlite::step_result::done);
+    }
+    {
+        auto stmt = db.prepare("INSERT INTO foo(a) VALUES (3), (4), (5) RETURNING a").value();
+        ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+        ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+        ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+        ASSERT_EQ(stmt.step(), sqlite::step_result::done);
+    }
+
+    auto s = m.snapshot();
+    ASSERT_EQ(s.size(), 4);
+    EXPECT_EQ(s[0].sql, "CREATE TABLE bar (b INTEGER)");
+    EXPECT_EQ(s[0].changes, 0);
+    EXPECT_EQ(s[1].sql, "DELETE FROM foo RETURNING a");
+    EXPECT_EQ(s[1].rows, 2);
+    EXPECT_EQ(s[1].changes, 2);
+    EXPECT_EQ(s[2].sql, "INSERT INTO foo(a) VALUES (1), (2)");
+    EXPECT_EQ(s[2].changes, 2);
+    EXPECT_EQ(s[3].sql, "INSERT INTO foo(a) VALUES (3), (4), (5) RETURNING a");
+    EXPECT_EQ(s[3].rows, 3);
+    EXPECT_EQ(s[3].changes, 3);
+}
+
+TEST(metrics, aggregates_threads)
+{
+    sqlite::metrics m;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&m] {
+            auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+            db.set_metrics(&m);
+            auto stmt = db.prepare("SELECT 1").value();
+            for (int i = 0; i < 10; ++i) {
+                ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+                ASSERT_TRUE(stmt.reset());
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto s = m.snapshot();
+    ASSERT_EQ(s.size(), 1);
+    EXPECT_EQ(s[0].prepare.count, 4);
+    EXPECT_EQ(s[0].rows, 40);
+}
+
+TEST(metrics, no_sink)
+{
+    sqlite::metrics m;
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto stmt = db.prepare("SELECT 1").value();
+    db.set_metrics(&m);
+    // Prepared before installing the sink.
+    ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+    EXPECT_TRUE(m.snapshot().empty());
+}
@@ -0,0 +1,52 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/snapshot.hpp"
+
+namespace
+{
+int count_rows(sqlite::database& db)
+{
+    auto stmt = db.prepare("SELECT count(1) FROM foo").value();
+    CHECK(stmt.step());
+    return stmt.column_int(0).value();
+}
+} // namespace
+
+TEST(snapshot, read_transactions)
+{
+    temp_database t("sqlitecpp-thin-snapshot-test");
+    auto writer = sqlite::open(t.path, sqlite::open_options{.journal = sqlite::journal_mode::wal}).value();
+    auto coordinator = sqlite::open(t.path, SQLITE_OPEN_READWRITE).value();
+    auto worker = sqlite::open(t.path, SQLITE_OPEN_READWRITE).value();
+    ASSERT_TRUE(writer.exec("CREATE TABLE foo (a INTEGER)"));
+    ASSERT_TRUE(writer.exec("INSERT INTO foo VALUES (1)"));
+
+    // The read transaction sees the database as of its start, not of its first query.
+    auto tx = sqlite::begin_read_transaction(coordinator).value();
+    ASSERT_TRUE(writer.exec("INSERT INTO foo VALUES (2)"));
+    EXPECT_EQ(count_rows(coordinator), 1);
+
+    auto s = sqlite::get_snapshot(coordinator);
+    if (!sqlite::snapshots_supported()) {
+        ASSERT_FALSE(s);
+        EXPECT_EQ(s.error().errcode, SQLITE_ERROR);
+        GTEST_SKIP() << "SQLite was built without SQLITE_ENABLE_SNAPSHOT";
+    }
+    ASSERT_TRUE(s);
+
+    // The worker starts after the second insert, but reads the snapshot of the coordinator.
+    {
+        auto worker_tx = sqlite::begin_read_transaction(worker, *s).value();
+        EXPECT_EQ(count_rows(worker), 1);
+        auto worker_s = sqlite::get_snapshot(worker).value();
+        EXPECT_EQ(worker_s.compare(*s), 0);
+        // A transaction is already active.
+        EXPECT_FALSE(sqlite::begin_read_transaction(worker, *s));
+    }
+    EXPECT_EQ(count_rows(worker), 2);
+
+    ASSERT_TRUE(tx.commit());
+    auto latest_tx = sqlite::begin_read_transaction(coordinator).value();
+    auto latest = sqlite::get_snapshot(coordinator).value();
+    EXPECT_GT(latest.compare(*s), 0);
+}
@@ -83,3 +83,44 @@ TEST(open, utf8_filename_fs_path)
     }
     ufh.test();
 }
+
+namespace
+{
+std::string pragma_value(sqlite::database& db, const char* pragma)
+{
+    auto stmt = db.prepare(std::string("PRAGMA ") + pragma).value();
+    CHECK(stmt.step());
+    return std::string(stmt.column_text(0).value());
+}
+} // namespace
+
+TEST(open, open_options)
+{
+    temp_database t("sqlitecpp-thin-open-options-test");
+    {
+        auto options = sqlite::open_options::oltp_wal();
+        options.page_size = 8192;
+        options.init_sql = "CREATE TABLE foo (a INTEGER)";
+        auto db = sqlite::open(t.path, options).value();
+        EXPECT_EQ(pragma_value(db, "page_size"), "8192");
+        EXPECT_EQ(pragma_value(db, "journal_mode"), "wal");
+        EXPECT_EQ(pragma_value(db, "synchronous"), "1");
+        EXPECT_EQ(pragma_value(db, "cache_size"), "-65536");
+        EXPECT_EQ(pragma_value(db, "temp_store"), "2");
+        EXPECT_EQ(pragma_value(db, "busy_timeout"), "5000");
+    }
+    {
+        auto db = sqlite::open(t.path, sqlite::open_options::read_only_mmap()).value();
+        EXPECT_EQ(pragma_value(db, "mmap_size"), std::to_string(1 << 30));
+        auto r = db.exec("INSERT INTO foo(a) VALUES(1)");
+        ASSERT_FALSE(r);
+        EXPECT_EQ(r.error().errcode(), SQLITE_READONLY);
+    }
+}
+
+TEST(open, open_options_error)
+{
+    auto db = sqlite::open(":memory:", sqlite::open_options{.init_sql = "NOT SQL"});
+    ASSERT_FALSE(db);
+    EXPECT_EQ(db.error().errcode, SQLITE_ERROR);
+}
@@ -0,0 +1,85 @@
+#include "test_util.hpp"
+
+TEST(statement_cache, hits_and_misses)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER)"));
+
+    for (int i = 0; i < 3; ++i) {
+        auto stmt = db.prepare_cached("INSERT INTO foo(a) VALUES(?)").value();
+        ASSERT_TRUE(stmt->bind_int(1, i));
+        ASSERT_EQ(stmt->step_done_changes(), 1);
+    }
+    // Same text, once with and once without size.
+    const std::string query = "SELECT count(1) FROM foo";
+    for (bool with_size : {false, true}) {
+        auto stmt = (with_size ? db.prepare_cached(query) : db.prepare_cached(query.c_str())).value();
+        ASSERT_EQ(stmt->step(), sqlite::step_result::row);
+        ASSERT_EQ(stmt->column_int(0), 3);
+    }
+
+    auto stats = db.get_statement_cache_stats();
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.hits, 3);
+    EXPECT_EQ(stats.size, 2);
+    EXPECT_EQ(stats.evictions, 0);
+}
+
+TEST(statement_cache, returned_statement_is_reset_and_cleared)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    sqlite3_stmt* handle{};
+    {
+        auto stmt = db.prepare_cached("SELECT ?").value();
+        handle = stmt->handle();
+        ASSERT_TRUE(stmt->bind_int(1, 42));
+        ASSERT_EQ(stmt->step(), sqlite::step_result::row);
+        ASSERT_TRUE(sqlite3_stmt_busy(handle));
+    }
+    auto stmt = db.prepare_cached("SELECT ?").value();
+    ASSERT_EQ(stmt->handle(), handle);
+    ASSERT_FALSE(sqlite3_stmt_busy(handle));
+    ASSERT_EQ(stmt->step(), sqlite::step_result::row);
+    ASSERT_EQ(sqlite3_column_type(stmt->handle(), 0), SQLITE_NULL);
+}
+
+TEST(statement_cache, lru_eviction)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    db.set_statement_cache_capacity(2);
+    ASSERT_TRUE(db.prepare_cached("SELECT 1"));
+    ASSERT_TRUE(db.prepare_cached("SELECT 2"));
+    ASSERT_TRUE(db.prepare_cached("SELECT 1")); // Hit, "SELECT 2" becomes the least recently used.
+    ASSERT_TRUE(db.prepare_cached("SELECT 3")); // Evicts "SELECT 2".
+    ASSERT_TRUE(db.prepare_cached("SELECT 1")); // Hit.
+    ASSERT_TRUE(db.prepare_cached("SELECT 2")); // Miss.
+
+    auto stats = db.get_statement_cache_stats();
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 4);
+    EXPECT_EQ(stats.evictions, 2);
+    EXPECT_EQ(stats.size, 2);
+
+    db.set_statement_cache_capacity(0);
+    EXPECT_EQ(db.get_statement_cache_stats().size, 0);
+}
+
+TEST(statement_cache, nested_use_of_same_query)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto outer = db.prepare_cached("SELECT 1").value();
+    {
+        auto inner = db.prepare_cached("SELECT 1").value();
+        ASSERT_NE(inner->handle(), outer->handle());
+        ASSERT_EQ(inner->step(), sqlite::step_result::row);
+    }
+    EXPECT_EQ(db.get_statement_cache_stats().size, 1);
+    ASSERT_EQ(outer->step(), sqlite::step_result::row);
+}
+
+TEST(statement_cache, close_with_idle_statements)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.prepare_cached("SELECT 1"));
+    ASSERT_TRUE(db.close());
+}
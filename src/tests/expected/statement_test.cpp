@@ -0,0 +1,239 @@
+#include "test_util.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace
+{
+sqlite::database open_test_db()
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    CHECK(db.exec("CREATE TABLE foo (id INTEGER, name TEXT, score REAL)"));
+    CHECK(db.exec("INSERT INTO foo VALUES(1, 'one', 1.5)"));
+    CHECK(db.exec("INSERT INTO foo VALUES(2, 'two', NULL)"));
+    CHECK(db.exec("INSERT INTO foo VALUES(3, NULL, 3.5)"));
+    return db;
+}
+} // namespace
+
+TEST(statement, rows)
+{
+    auto db = open_test_db();
+    auto stmt = db.prepare("SELECT id, name, score FROM foo ORDER BY id").value();
+
+    std::vector<std::tuple<int64_t, std::string, std::optional<double>>> result;
+    auto rows = stmt.rows<int64_t, std::string_view, std::optional<double>>();
+    for (auto [id, name, score] : rows) {
+        result.emplace_back(id, std::string(name), score);
+    }
+    ASSERT_FALSE(rows.get_error());
+
+    const decltype(result) expected_result = {
+      {1, "one", 1.5         },
+      {2, "two", std::nullopt},
+      {3, "",    3.5         }
+    };
+    ASSERT_EQ(result, expected_result);
+}
+
+TEST(statement, rows_empty_result)
+{
+    auto db = open_test_db();
+    auto stmt = db.prepare("SELECT id FROM foo WHERE id > 3").value();
+    auto rows = stmt.rows<int>();
+    ASSERT_EQ(rows.begin(), rows.end());
+    ASSERT_FALSE(rows.get_error());
+}
+
+TEST(statement, rows_error_ends_iteration)
+{
+    auto db = open_test_db();
+    // Malformed JSON is a runtime error on the second row.
+    auto stmt = db.prepare("SELECT CASE WHEN id = 2 THEN json(name) ELSE id END FROM foo").value();
+    size_t count = 0;
+    auto rows = stmt.rows<int64_t>();
+    for ([[maybe_unused]] auto [x] : rows) {
+        ++count;
+    }
+    ASSERT_EQ(count, 1);
+    ASSERT_TRUE(rows.get_error());
+    ASSERT_EQ(rows.get_error()->errcode, SQLITE_ERROR);
+}
+
+TEST(statement, bind_all)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto stmt = db.prepare("SELECT ?, ?, ?, ?, ?, ?, ?, ?, ?").value();
+
+    const std::string s = "string";
+    const std::byte bytes[] = {std::byte(1), std::byte(2)};
+    const std::optional<double> no_double;
+    ASSERT_TRUE(stmt.bind_all(
+      short(1), int64_t(2), 3.5, "text", s, std::span<const std::byte>(bytes), std::nullopt, std::optional(4), no_double
+    ));
+    ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+
+    auto* h = stmt.handle();
+    EXPECT_EQ(sqlite3_column_int(h, 0), 1);
+    EXPECT_EQ(sqlite3_column_int64(h, 1), 2);
+    EXPECT_EQ(sqlite3_column_double(h, 2), 3.5);
+    EXPECT_EQ(stmt.column_text(3), "text");
+    EXPECT_EQ(stmt.column_text(4), s);
+    EXPECT_EQ(sqlite3_column_type(h, 5), SQLITE_BLOB);
+    EXPECT_EQ(sqlite3_column_bytes(h, 5), 2);
+    EXPECT_EQ(sqlite3_column_type(h, 6), SQLITE_NULL);
+    EXPECT_EQ(sqlite3_column_int(h, 7), 4);
+    EXPECT_EQ(sqlite3_column_type(h, 8), SQLITE_NULL);
+}
+
+TEST(statement, bind_int_conversions)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto stmt = db.prepare("SELECT ?, ?, ?").value();
+    // Small integers through sqlite3_bind_int(), the others through sqlite3_bind_int64().
+    ASSERT_TRUE(stmt.bind_int(1, short(-1)));
+    ASSERT_TRUE(stmt.bind_int(2, uint16_t(65535)));
+    ASSERT_TRUE(stmt.bind_int(3, uint32_t(4000000000)));
+    ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+    EXPECT_EQ(stmt.unchecked().column_int(0), -1);
+    EXPECT_EQ(stmt.unchecked().column_int(1), 65535);
+    EXPECT_EQ(stmt.unchecked().column_int64(2), 4000000000);
+}
+
+TEST(statement, bind_all_error)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto stmt = db.prepare("SELECT ?").value();
+    auto result = stmt.bind_all(1, 2);
+    ASSERT_FALSE(result);
+    ASSERT_EQ(result.error().errcode(), SQLITE_RANGE);
+}
+
+TEST(statement, execute)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER PRIMARY KEY, b TEXT)"));
+    auto stmt = db.prepare("INSERT INTO foo(a, b) VALUES(?, ?)").value();
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(stmt.execute(i, "x"), 1);
+    }
+    auto result = stmt.execute(0, "duplicate");
+    ASSERT_FALSE(result);
+    ASSERT_EQ(result.error().errcode(), SQLITE_CONSTRAINT);
+
+    auto count = db.prepare("SELECT count(1) FROM foo").value();
+    ASSERT_EQ(count.step(), sqlite::step_result::row);
+    ASSERT_EQ(count.column_int(0), 10);
+}
+
+TEST(statement, fetch_columns)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER, b REAL)"));
+    auto insert = db.prepare("INSERT INTO foo(a, b) VALUES(?, ?)").value();
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(insert.execute(i, i % 3 == 0 ? std::nullopt : std::optional(i * 0.5)), 1);
+    }
+
+    for (bool with_validity : {false, true}) {
+        auto stmt = db.prepare("SELECT a, b FROM foo ORDER BY a").value();
+        std::vector<int64_t> a;
+        std::vector<double> b;
+        std::vector<sqlite::validity_bitmap> validity(with_validity ? 2 : 0);
+        size_t num_batches = 0;
+        for (;;) {
+            auto n = stmt.fetch_columns(32, validity, a, b);
+            ASSERT_TRUE(n);
+            ++num_batches;
+            if (*n < 32) {
+                break;
+            }
+        }
+        ASSERT_EQ(num_batches, 4);
+        ASSERT_EQ(a.size(), 100);
+        ASSERT_EQ(b.size(), 100);
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_EQ(a[size_t(i)], i);
+            EXPECT_EQ(b[size_t(i)], i % 3 == 0 ? 0.0 : i * 0.5);
+        }
+        if (with_validity) {
+            ASSERT_EQ(validity[0].size(), 100);
+            ASSERT_EQ(validity[1].size(), 100);
+            ASSERT_EQ(validity[1].words().size(), 2);
+            for (size_t i = 0; i < 100; ++i) {
+                EXPECT_TRUE(validity[0][i]);
+                EXPECT_EQ(validity[1][i], i % 3 != 0);
+            }
+        }
+    }
+}
+
+TEST(statement, column_opt_null_after_step)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto stmt = db.prepare("SELECT NULL, 0").value();
+    ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+    ASSERT_EQ(stmt.column_type(0), sqlite::datatype::null);
+    ASSERT_EQ(stmt.column_int_opt(0), std::nullopt);
+    ASSERT_EQ(stmt.column_int_opt(1), 0);
+}
+
+TEST(statement, status)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (a INTEGER)"));
+    ASSERT_TRUE(db.exec("INSERT INTO foo(a) VALUES (3), (1), (2)"));
+
+    auto stmt = db.prepare("SELECT a FROM foo ORDER BY a").value();
+    for ([[maybe_unused]] auto [a] : stmt.rows<int>()) {
+    }
+    auto s = stmt.status();
+    EXPECT_EQ(s.fullscan_step, 2);
+    EXPECT_EQ(s.sort, 1);
+    EXPECT_EQ(s.autoindex, 0);
+    EXPECT_GT(s.vm_step, 0);
+    EXPECT_EQ(s.run, 1);
+    EXPECT_GT(s.memused, 0);
+
+    s = stmt.status(true);
+    EXPECT_EQ(s.sort, 1);
+    s = stmt.status();
+    EXPECT_EQ(s.fullscan_step, 0);
+    EXPECT_EQ(s.sort, 0);
+    EXPECT_EQ(s.vm_step, 0);
+    EXPECT_GT(s.memused, 0);
+}
+
+TEST(statement, column_int64_is_not_truncated)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto stmt = db.prepare("SELECT 1 << 40, NULL").value();
+    ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+    EXPECT_EQ(stmt.column_int64(0), int64_t(1) << 40);
+    EXPECT_EQ(stmt.column_int64_opt(0).value(), std::optional<int64_t>(int64_t(1) << 40));
+    EXPECT_EQ(stmt.column_int64_opt(1).value(), std::nullopt);
+}
+
+TEST(statement, unchecked)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto stmt = db.prepare("SELECT 42, 1 << 40, 0.5, 'text', x'0102', NULL, 0").value();
+    ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+
+    auto u = stmt.unchecked();
+    EXPECT_EQ(u.column_int(0), 42);
+    EXPECT_EQ(u.column_int64(1), int64_t(1) << 40);
+    EXPECT_EQ(u.column_double(2), 0.5);
+    EXPECT_EQ(u.column_text(3), "text");
+    EXPECT_EQ(u.column_blob(4).size(), 2);
+    EXPECT_EQ(u.column_type(5), sqlite::datatype::null);
+    EXPECT_EQ(u.column_int_opt(5), std::nullopt);
+    EXPECT_EQ(u.column_text_opt(5), std::nullopt);
+    EXPECT_EQ(u.column_int_opt(6), std::optional<int>(0));
+    EXPECT_EQ(u.column_double_opt(2), std::optional<double>(0.5));
+    EXPECT_TRUE(u.check());
+
+    ASSERT_EQ(stmt.step(), sqlite::step_result::done);
+    EXPECT_TRUE(u.check());
+}
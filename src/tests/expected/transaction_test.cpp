@@ -0,0 +1,167 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/transaction.hpp"
+
+namespace
+{
+sqlite::database open_with_table()
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    CHECK(db.exec("CREATE TABLE foo (a INTEGER)"));
+    return db;
+}
+
+int count_rows(sqlite::database& db)
+{
+    auto stmt = db.prepare("SELECT count(1) FROM foo").value();
+    CHECK(stmt.step());
+    return stmt.column_int(0).value();
+}
+} // namespace
+
+TEST(transaction, commit_and_rollback)
+{
+    auto db = open_with_table();
+    {
+        auto tx = sqlite::begin_transaction(db).value();
+        EXPECT_FALSE(tx.is_nested());
+        EXPECT_FALSE(sqlite3_get_autocommit(db.handle()));
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (1)"));
+        ASSERT_TRUE(tx.commit());
+        EXPECT_FALSE(tx.is_active());
+    }
+    EXPECT_TRUE(sqlite3_get_autocommit(db.handle()));
+    EXPECT_EQ(count_rows(db), 1);
+
+    {
+        auto tx = sqlite::begin_transaction(db, sqlite::transaction_mode::immediate).value();
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (2)"));
+        // Rolled back by the destructor.
+    }
+    EXPECT_TRUE(sqlite3_get_autocommit(db.handle()));
+    EXPECT_EQ(count_rows(db), 1);
+
+    {
+        auto tx = sqlite::begin_transaction(db, sqlite::transaction_mode::exclusive).value();
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (3)"));
+        ASSERT_TRUE(tx.rollback());
+    }
+    EXPECT_EQ(count_rows(db), 1);
+
+    // BEGIN, COMMIT and ROLLBACK are prepared once.
+    for (int i = 0; i < 3; ++i) {
+        auto tx = sqlite::begin_transaction(db).value();
+        ASSERT_TRUE(tx.commit());
+    }
+    EXPECT_GE(db.get_statement_cache_stats().hits, 3);
+}
+
+TEST(transaction, nested)
+{
+    auto db = open_with_table();
+    auto outer = sqlite::begin_transaction(db).value();
+    ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (1)"));
+    {
+        auto inner = sqlite::begin_transaction(db, sqlite::transaction_mode::immediate).value();
+        EXPECT_TRUE(inner.is_nested());
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (2)"));
+        {
+            auto innermost = sqlite::begin_transaction(db).value();
+            ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (3)"));
+            // Rolled back by the destructor.
+        }
+        EXPECT_EQ(count_rows(db), 2);
+        ASSERT_TRUE(inner.commit());
+    }
+    {
+        auto inner = sqlite::begin_transaction(db).value();
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (4)"));
+        ASSERT_TRUE(inner.rollback());
+    }
+    EXPECT_FALSE(sqlite3_get_autocommit(db.handle()));
+    EXPECT_EQ(count_rows(db), 2);
+    ASSERT_TRUE(outer.commit());
+    EXPECT_TRUE(sqlite3_get_autocommit(db.handle()));
+    EXPECT_EQ(count_rows(db), 2);
+}
+
+TEST(transaction, savepoint)
+{
+    auto db = open_with_table();
+    {
+        // Outside of a transaction the savepoint starts one.
+        auto sp = sqlite::begin_savepoint(db).value();
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (1)"));
+        {
+            auto nested = sqlite::begin_savepoint(db).value();
+            ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (2)"));
+        }
+        EXPECT_EQ(count_rows(db), 1);
+        ASSERT_TRUE(sp.release());
+        EXPECT_FALSE(sp.is_active());
+    }
+    EXPECT_TRUE(sqlite3_get_autocommit(db.handle()));
+    EXPECT_EQ(count_rows(db), 1);
+
+    {
+        auto tx = sqlite::begin_transaction(db).value();
+        auto sp = sqlite::begin_savepoint(db).value();
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (2)"));
+        ASSERT_TRUE(sp.rollback());
+        ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (3)"));
+        ASSERT_TRUE(tx.commit());
+    }
+    EXPECT_EQ(count_rows(db), 2);
+}
+
+TEST(transaction, failed_rollback_stays_active)
+{
+    auto db = open_with_table();
+    // Fail the preparation of ROLLBACK and ROLLBACK TO.
+    auto deny_rollback = [](void*, int action, const char* arg1, const char*, const char*, const char*) {
+        const bool is_rollback = (action == SQLITE_TRANSACTION || action == SQLITE_SAVEPOINT)
+                              && std::string_view(arg1) == "ROLLBACK";
+        return is_rollback ? SQLITE_DENY : SQLITE_OK;
+    };
+
+    auto tx = sqlite::begin_transaction(db).value();
+    auto sp = sqlite::begin_savepoint(db).value();
+    ASSERT_TRUE(db.exec("INSERT INTO foo VALUES (1)"));
+    sqlite3_set_authorizer(db.handle(), deny_rollback, nullptr);
+    auto r = sp.rollback();
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error().errcode(), SQLITE_AUTH);
+    EXPECT_TRUE(sp.is_active());
+    r = tx.rollback();
+    ASSERT_FALSE(r);
+    EXPECT_TRUE(tx.is_active());
+
+    sqlite3_set_authorizer(db.handle(), nullptr, nullptr);
+    ASSERT_TRUE(sp.rollback());
+    EXPECT_FALSE(sp.is_active());
+    ASSERT_TRUE(tx.rollback());
+    EXPECT_FALSE(tx.is_active());
+    EXPECT_TRUE(sqlite3_get_autocommit(db.handle()));
+    EXPECT_EQ(count_rows(db), 0);
+}
+
+TEST(transaction, immediate_takes_the_write_lock)
+{
+    temp_database t("sqlitecpp-thin-transaction-test");
+    auto db1 = sqlite::open(t.path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    auto db2 = sqlite::open(t.path, SQLITE_OPEN_READWRITE).value();
+    ASSERT_TRUE(db1.exec("CREATE TABLE foo (a INTEGER)"));
+
+    auto deferred = sqlite::begin_transaction(db1).value();
+    ASSERT_TRUE(sqlite::begin_transaction(db2, sqlite::transaction_mode::immediate));
+    // db2's transaction was rolled back at the end of the statement above, a new immediate one can start.
+    ASSERT_TRUE(deferred.commit());
+
+    auto immediate = sqlite::begin_transaction(db1, sqlite::transaction_mode::immediate).value();
+    auto r = sqlite::begin_transaction(db2, sqlite::transaction_mode::immediate);
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error().errcode(), SQLITE_BUSY);
+    // The failed BEGIN doesn't leave a transaction behind.
+    EXPECT_TRUE(sqlite3_get_autocommit(db2.handle()));
+    ASSERT_TRUE(immediate.commit());
+}
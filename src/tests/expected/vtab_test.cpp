@@ -0,0 +1,248 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/vtab.hpp"
+
+namespace
+{
+struct person {
+    int64_t id;
+    std::string name;
+    double score;
+    std::vector<std::byte> avatar;
+
+    std::string upper_name() const
+    {
+        std::string s = name;
+        std::transform(s.begin(), s.end(), s.begin(), [](char c) { return char(std::toupper(c)); });
+        return s;
+    }
+};
+
+std::vector<person> make_people()
+{
+    std::vector<person> people;
+    for (int64_t i = 0; i < 1000; ++i) {
+        people.push_back(person{
+          .id = i * 2, .name = "p" + std::to_string(i), .score = double(i) / 4, .avatar = {std::byte(i % 256)}});
+    }
+    return people;
+}
+
+constexpr auto fizz = [](const person& p) {
+    return p.id % 3 == 0 ? std::optional<int>(1) : std::nullopt;
+};
+
+sqlite::span_table<person> make_table(std::span<const person> people)
+{
+    return sqlite::span_table<person>{
+      .rows = people,
+      .columns =
+        {
+          sqlite::table_column<person, &person::id>("id INTEGER"),
+          sqlite::table_column<person, &person::name>("name TEXT"),
+          sqlite::table_column<person, &person::score>("score REAL"),
+          sqlite::table_column<person, &person::avatar>("avatar BLOB"),
+          sqlite::table_column<person, &person::upper_name>("upper_name TEXT"),
+          sqlite::table_column<person, fizz>("fizz INTEGER"),
+        },
+      .sorted_key = 0,
+    };
+}
+
+std::vector<int64_t> query_ids(sqlite::database& db, const std::string& sql)
+{
+    std::vector<int64_t> ids;
+    auto stmt = db.prepare(sql).value();
+    for (;;) {
+        auto r = stmt.step().value();
+        if (r == sqlite::step_result::done) {
+            return ids;
+        }
+        ids.push_back(stmt.unchecked().column_int64(0));
+    }
+}
+
+std::string query_plan(sqlite::database& db, const std::string& sql)
+{
+    std::string plan;
+    auto stmt = db.prepare("EXPLAIN QUERY PLAN " + sql).value();
+    while (stmt.step().value() == sqlite::step_result::row) {
+        plan += stmt.unchecked().column_text(3);
+        plan += "\n";
+    }
+    return plan;
+}
+} // namespace
+
+TEST(vtab, span_table_columns)
+{
+    auto people = make_people();
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(sqlite::register_span_table(db, "people", make_table(people)));
+
+    auto stmt = db.prepare("SELECT id, name, score, avatar, upper_name, fizz FROM people WHERE id = 6").value();
+    ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+    auto row = stmt.unchecked();
+    EXPECT_EQ(row.column_int64(0), 6);
+    EXPECT_EQ(row.column_text(1), "p3");
+    EXPECT_EQ(row.column_double(2), 0.75);
+    ASSERT_EQ(row.column_blob(3).size(), 1);
+    EXPECT_EQ(row.column_blob(3)[0], std::byte(3));
+    EXPECT_EQ(row.column_text(4), "P3");
+    EXPECT_EQ(row.column_int_opt(5), 1);
+    ASSERT_EQ(stmt.step(), sqlite::step_result::done);
+
+    EXPECT_EQ(query_ids(db, "SELECT count(*) FROM people"), std::vector<int64_t>{1000});
+    EXPECT_EQ(query_ids(db, "SELECT count(*) FROM people WHERE fizz IS NULL"), std::vector<int64_t>{666});
+
+    // Named instance of the module.
+    ASSERT_TRUE(db.exec("CREATE VIRTUAL TABLE temp.staff USING people"));
+    EXPECT_EQ(query_ids(db, "SELECT id FROM staff WHERE name = 'p2'"), std::vector<int64_t>{4});
+}
+
+TEST(vtab, span_table_empty_values)
+{
+    // Empty text and blobs read in place are '' and x'', not NULL.
+    std::vector<person> people{person{.id = 1, .name = "", .score = 0, .avatar = {}}};
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(sqlite::register_span_table(
+      db, "people",
+      sqlite::span_table<person>{
+        .rows = people,
+        .columns =
+          {
+            sqlite::table_column<person, &person::avatar>("avatar BLOB"),
+            sqlite::table_column<person, [](const person&) { return std::string_view(); }>("nickname TEXT"),
+          },
+        .sorted_key = -1,
+      }));
+
+    auto stmt = db.prepare("SELECT typeof(avatar), avatar = x'', typeof(nickname), nickname = '' FROM people").value();
+    ASSERT_EQ(stmt.step(), sqlite::step_result::row);
+    auto row = stmt.unchecked();
+    EXPECT_EQ(row.column_text(0), "blob");
+    EXPECT_EQ(row.column_int(1), 1);
+    EXPECT_EQ(row.column_text(2), "text");
+    EXPECT_EQ(row.column_int(3), 1);
+}
+
+TEST(vtab, span_table_sorted_key)
+{
+    auto people = make_people();
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(sqlite::register_span_table(db, "people", make_table(people)));
+
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id = 10"), std::vector<int64_t>{10});
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id = '10'"), std::vector<int64_t>{10});
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id = 11"), std::vector<int64_t>{});
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id = NULL"), std::vector<int64_t>{});
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id > 1990"), (std::vector<int64_t>{1992, 1994, 1996, 1998}));
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id >= 1996.0"), (std::vector<int64_t>{1996, 1998}));
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id < 4"), (std::vector<int64_t>{0, 2}));
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id <= 4"), (std::vector<int64_t>{0, 2, 4}));
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id BETWEEN 9 AND 13.5"), (std::vector<int64_t>{10, 12}));
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id > 20 AND id < 10"), std::vector<int64_t>{});
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id IN (3, 4, 8)"), (std::vector<int64_t>{4, 8}));
+    EXPECT_EQ(query_ids(db, "SELECT id FROM people WHERE id < 'a' AND id > 1994"), (std::vector<int64_t>{1996, 1998}));
+
+    EXPECT_NE(query_plan(db, "SELECT id FROM people WHERE id = 10").find("INDEX 1:"), std::string::npos);
+    EXPECT_NE(query_plan(db, "SELECT id FROM people WHERE id > 10").find("INDEX 2:"), std::string::npos);
+    EXPECT_NE(query_plan(db, "SELECT id FROM people WHERE name = 'p1'").find("INDEX 0:"), std::string::npos);
+    // The rows are in key order.
+    EXPECT_EQ(query_plan(db, "SELECT id FROM people ORDER BY id").find("ORDER BY"), std::string::npos);
+
+    // Joined against a regular table, seeking into the span table.
+    ASSERT_TRUE(db.exec("CREATE TABLE orders (person_id INTEGER, amount REAL)"));
+    ASSERT_TRUE(db.exec("INSERT INTO orders VALUES (4, 1.5), (7, 2.5), (1998, 3.5)"));
+    const std::string join = "SELECT p.id FROM orders o JOIN people p ON p.id = o.person_id ORDER BY p.id";
+    EXPECT_EQ(query_ids(db, join), (std::vector<int64_t>{4, 1998}));
+    EXPECT_NE(query_plan(db, join).find("INDEX 1:"), std::string::npos);
+}
+
+TEST(vtab, span_table_key_comparisons)
+{
+    EXPECT_EQ(sqlite::get_declared_affinity("id INTEGER PRIMARY KEY"), sqlite::column_affinity::numeric);
+    EXPECT_EQ(sqlite::get_declared_affinity("\"int\" varchar(10) NOT NULL"), sqlite::column_affinity::text);
+    EXPECT_EQ(sqlite::get_declared_affinity("name"), sqlite::column_affinity::blob);
+    EXPECT_EQ(sqlite::get_declared_affinity("name CONSTRAINT c NOT NULL"), sqlite::column_affinity::blob);
+    EXPECT_EQ(sqlite::get_declared_affinity("x DECIMAL(10, 2)"), sqlite::column_affinity::numeric);
+
+    // Sorted by name in the BINARY collation.
+    std::vector<person> people;
+    for (auto* name : {"1", "2", "Ann", "Bob", "ann"}) {
+        people.push_back(person{.id = int64_t(people.size()), .name = name, .score = 0, .avatar = {}});
+    }
+    auto make_name_table = [&](const char* declaration) {
+        return sqlite::span_table<person>{
+          .rows = people,
+          .columns =
+            {
+              sqlite::table_column<person, &person::id>("id INTEGER"),
+              sqlite::table_column<person, &person::name>(declaration),
+            },
+          .sorted_key = 1,
+        };
+    };
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(sqlite::register_span_table(db, "by_name", make_name_table("name TEXT")));
+    ASSERT_TRUE(sqlite::register_span_table(db, "by_blob_name", make_name_table("name")));
+
+    EXPECT_EQ(query_ids(db, "SELECT id FROM by_name WHERE name = 'Bob'"), std::vector<int64_t>{3});
+    EXPECT_NE(query_plan(db, "SELECT id FROM by_name WHERE name = 'Bob'").find("INDEX 1:"), std::string::npos);
+    // The text affinity of the column applies to the number.
+    EXPECT_EQ(query_ids(db, "SELECT id FROM by_name WHERE name = 2"), std::vector<int64_t>{1});
+    // Not searched in another collation.
+    const std::string nocase = "SELECT id FROM by_name WHERE name = 'ann' COLLATE NOCASE";
+    EXPECT_EQ(query_ids(db, nocase), (std::vector<int64_t>{2, 4}));
+    EXPECT_NE(query_plan(db, nocase).find("INDEX 0:"), std::string::npos);
+    // Nor if the affinity of the column isn't the one of the comparator: without affinity, 2 isn't '2'.
+    EXPECT_EQ(query_ids(db, "SELECT id FROM by_blob_name WHERE name = 2"), std::vector<int64_t>{});
+    EXPECT_EQ(query_ids(db, "SELECT id FROM by_blob_name WHERE name = 'Bob'"), std::vector<int64_t>{3});
+    EXPECT_NE(query_plan(db, "SELECT id FROM by_blob_name WHERE name = 'Bob'").find("INDEX 0:"), std::string::npos);
+}
+
+TEST(vtab, bind_array)
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    ASSERT_TRUE(sqlite::register_carray(db));
+    ASSERT_TRUE(db.exec("CREATE TABLE foo (id INTEGER PRIMARY KEY, x REAL, s TEXT)"));
+    ASSERT_TRUE(db.exec("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 100) "
+                        "INSERT INTO foo SELECT i, i * 0.5, 's' || i FROM n"));
+
+    auto by_id = db.prepare("SELECT id FROM foo WHERE id IN carray(?) ORDER BY id").value();
+    auto query = [](sqlite::statement& stmt) {
+        std::vector<int64_t> ids;
+        while (stmt.step().value() == sqlite::step_result::row) {
+            ids.push_back(stmt.unchecked().column_int64(0));
+        }
+        CHECK(stmt.reset());
+        return ids;
+    };
+    const std::vector<int64_t> ids = {7, 3, 500, 42};
+    ASSERT_TRUE(by_id.bind_array(1, ids));
+    EXPECT_EQ(query(by_id), (std::vector<int64_t>{3, 7, 42}));
+    const std::vector<int64_t> more_ids = {1, 2, 3, 4, 5, 6};
+    ASSERT_TRUE(by_id.bind_array(1, more_ids));
+    EXPECT_EQ(query(by_id), (std::vector<int64_t>{1, 2, 3, 4, 5, 6}));
+    ASSERT_TRUE(by_id.bind_array(1, std::span<const int64_t>()));
+    EXPECT_EQ(query(by_id), std::vector<int64_t>{});
+    // Unbound or not an array: empty.
+    ASSERT_TRUE(by_id.bind_int(1, 3));
+    EXPECT_EQ(query(by_id), std::vector<int64_t>{});
+
+    auto by_x = db.prepare("SELECT id FROM foo WHERE x IN carray(?) ORDER BY id").value();
+    const std::vector<double> xs = {0.5, 10.0, 10.25};
+    ASSERT_TRUE(by_x.bind_array(1, xs));
+    EXPECT_EQ(query(by_x), (std::vector<int64_t>{1, 20}));
+
+    auto by_s = db.prepare("SELECT foo.id FROM carray(?) AS c JOIN foo ON foo.s = c.value ORDER BY foo.id").value();
+    const std::vector<std::string_view> names = {"s9", "nope", "", "s5"};
+    ASSERT_TRUE(by_s.bind_array(1, names));
+    EXPECT_EQ(query(by_s), (std::vector<int64_t>{5, 9}));
+
+    auto values = db.prepare("SELECT value, typeof(value) FROM carray(?)").value();
+    ASSERT_TRUE(values.bind_array(1, names));
+    ASSERT_EQ(values.step(), sqlite::step_result::row);
+    EXPECT_EQ(values.unchecked().column_text(0), "s9");
+    EXPECT_EQ(values.unchecked().column_text(1), "text");
+}
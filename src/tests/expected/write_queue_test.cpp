@@ -0,0 +1,197 @@
+#include "test_util.hpp"
+
+#include "sqlitecpp-thin/write_queue.hpp"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+sqlite::database open_with_table()
+{
+    auto db = sqlite::open(":memory:", SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE).value();
+    CHECK(db.exec("CREATE TABLE foo (a INTEGER PRIMARY KEY, b TEXT)"));
+    return db;
+}
+
+template<class... Args>
+concept can_submit_execute = requires(sqlite::write_queue& q, Args... args) { q.submit_execute("", args...); };
+
+// Only the views which can be copied into an owning type are accepted.
+static_assert(can_submit_execute<int, std::string_view, const char*, std::optional<std::string_view>>);
+static_assert(!can_submit_execute<std::span<const std::byte>>);
+
+int count_rows(sqlite::database& db)
+{
+    auto stmt = db.prepare("SELECT count(1) FROM foo").value();
+    CHECK(stmt.step());
+    return stmt.column_int(0).value();
+}
+} // namespace
+
+TEST(write_queue, submit_from_threads)
+{
+    constexpr int k_num_threads = 4;
+    constexpr int k_jobs_per_thread = 250;
+    sqlite::write_queue q(open_with_table(), sqlite::write_queue_options{.max_batch_size = 64});
+
+    std::vector<std::thread> threads;
+    std::vector<std::vector<std::future<std::expected<int, sqlite::error>>>> futures(k_num_threads);
+    for (int t = 0; t < k_num_threads; ++t) {
+        threads.emplace_back([&q, &f = futures[size_t(t)], t] {
+            for (int i = 0; i < k_jobs_per_thread; ++i) {
+                f.push_back(q.submit_execute("INSERT INTO foo VALUES (?, ?)", t * k_jobs_per_thread + i,
+                                             std::string("row ") + std::to_string(i)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& f : futures) {
+        for (auto& x : f) {
+            auto r = x.get();
+            ASSERT_TRUE(r);
+            EXPECT_EQ(*r, 1);
+        }
+    }
+
+    auto n = q.submit([](sqlite::database& db) {
+                  return count_rows(db);
+              })
+               .get();
+    ASSERT_TRUE(n);
+    EXPECT_EQ(*n, k_num_threads * k_jobs_per_thread);
+
+    auto stats = q.get_stats();
+    EXPECT_EQ(stats.jobs, uint64_t(k_num_threads * k_jobs_per_thread + 1));
+    EXPECT_EQ(stats.failed_jobs, 0u);
+    EXPECT_GE(stats.batches, uint64_t(k_num_threads * k_jobs_per_thread / 64));
+    EXPECT_LE(stats.batches, stats.jobs);
+}
+
+TEST(write_queue, batch_delay_groups_jobs)
+{
+    sqlite::write_queue q(open_with_table(),
+                          sqlite::write_queue_options{.max_batch_size = 100,
+                                                      .max_batch_delay = std::chrono::milliseconds(200)});
+    std::vector<std::future<std::expected<int, sqlite::error>>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures.push_back(q.submit_execute("INSERT INTO foo(a) VALUES (?)", i));
+    }
+    for (auto& f : futures) {
+        EXPECT_TRUE(f.get());
+    }
+    EXPECT_EQ(q.get_stats().batches, 1u);
+}
+
+TEST(write_queue, submit_execute_copies_views)
+{
+    sqlite::write_queue q(
+      open_with_table(), sqlite::write_queue_options{.max_batch_delay = std::chrono::milliseconds(50)}
+    );
+    std::future<std::expected<int, sqlite::error>> f1;
+    std::future<std::expected<int, sqlite::error>> f2;
+    {
+        std::string text = "copied";
+        f1 = q.submit_execute("INSERT INTO foo VALUES (?, ?)", 1, std::string_view(text));
+        f2 = q.submit_execute("INSERT INTO foo VALUES (?, ?)", 2, text.c_str());
+        text.assign(text.size(), 'x');
+    }
+    EXPECT_EQ(f1.get(), 1);
+    EXPECT_EQ(f2.get(), 1);
+    auto rows = q.submit([](sqlite::database& db) {
+                     auto stmt = db.prepare("SELECT count(1) FROM foo WHERE b = 'copied'").value();
+                     CHECK(stmt.step());
+                     return stmt.column_int(0).value();
+                 })
+                  .get();
+    EXPECT_EQ(rows, 2);
+}
+
+TEST(write_queue, failed_job_is_rolled_back_alone)
+{
+    sqlite::write_queue q(
+      open_with_table(), sqlite::write_queue_options{.max_batch_delay = std::chrono::milliseconds(200)}
+    );
+
+    auto ok1 = q.submit_execute("INSERT INTO foo VALUES (1, 'a')");
+    // Its first INSERT is undone along with the failing one.
+    auto duplicate = q.submit([](sqlite::database& db) -> std::expected<void, sqlite::current_error> {
+        if (auto r = db.exec("INSERT INTO foo VALUES (2, 'b')"); !r) {
+            return r;
+        }
+        return db.exec("INSERT INTO foo VALUES (1, 'c')");
+    });
+    auto throws = q.submit([](sqlite::database& db) -> int {
+        CHECK(db.exec("INSERT INTO foo VALUES (3, 'd')"));
+        throw std::runtime_error("job failed");
+    });
+    auto ok2 = q.submit_execute("INSERT INTO foo VALUES (4, 'e')");
+
+    EXPECT_TRUE(ok1.get());
+    auto r = duplicate.get();
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error().errcode, SQLITE_CONSTRAINT);
+    EXPECT_THROW(throws.get(), std::runtime_error);
+    EXPECT_TRUE(ok2.get());
+
+    auto rows = q.submit([](sqlite::database& db) {
+                     std::string s;
+                     auto stmt = db.prepare("SELECT b FROM foo ORDER BY a").value();
+                     while (stmt.step().value() == sqlite::step_result::row) {
+                         s += stmt.unchecked().column_text(0);
+                     }
+                     return s;
+                 })
+                  .get();
+    ASSERT_TRUE(rows);
+    EXPECT_EQ(*rows, "ae");
+    EXPECT_EQ(q.get_stats().failed_jobs, 2u);
+}
+
+TEST(write_queue, destructor_drains_the_queue)
+{
+    std::future<std::expected<void, sqlite::error>> last;
+    {
+        sqlite::write_queue q(open_with_table());
+        for (int i = 0; i < 100; ++i) {
+            q.submit_execute("INSERT INTO foo(a) VALUES (?)", i);
+        }
+        last = q.submit([](sqlite::database& db) {
+            EXPECT_EQ(count_rows(db), 100);
+        });
+    }
+    EXPECT_TRUE(last.get());
+}
+
+TEST(write_queue, batch_rolled_back_by_sqlite)
+{
+    sqlite::write_queue q(
+      open_with_table(), sqlite::write_queue_options{.max_batch_delay = std::chrono::milliseconds(200)}
+    );
+
+    auto lost = q.submit_execute("INSERT INTO foo VALUES (1, 'a')");
+    // Stands for an error after which SQLite rolls back the transaction by itself (SQLITE_FULL, SQLITE_IOERR...).
+    auto rolls_back = q.submit([](sqlite::database& db) -> std::expected<void, sqlite::current_error> {
+        CHECK(db.exec("ROLLBACK"));
+        return db.exec("INSERT INTO missing VALUES (1)");
+    });
+    // Runs in the next batch.
+    auto next = q.submit_execute("INSERT INTO foo VALUES (2, 'b')");
+
+    auto r = lost.get();
+    ASSERT_FALSE(r);
+    EXPECT_EQ(r.error().errcode, SQLITE_ERROR);
+    EXPECT_FALSE(rolls_back.get());
+    EXPECT_TRUE(next.get());
+
+    auto rows = q.submit([](sqlite::database& db) {
+                     return count_rows(db);
+                 })
+                  .get();
+    ASSERT_TRUE(rows);
+    EXPECT_EQ(*rows, 1);
+    EXPECT_GE(q.get_stats().batches, 2u);
+}